@@ -0,0 +1,382 @@
+#include "boundedsettingscache.h"
+#include "settingsmetrics.h"
+#include <QStringList>
+#include <QDebug>
+#include <atomic>
+
+namespace {
+// Rough heap cost of a resident group and of one map node, beyond their strings
+const qint64 EntryOverhead = 128;
+const qint64 NodeOverhead = 64;
+// Operations between attempts to write back after the store failed
+const int WriteBackRetryInterval = 1000;
+
+// Across all instances; see filterTotals()
+std::atomic<int> processFilters{0};
+std::atomic<qint64> processFilterBytes{0};
+}
+
+BoundedSettingsCache::BoundedSettingsCache(SettingsBackend* backend, qint64 memoryBudget)
+    : backend(backend), budget(memoryBudget) {}
+
+BoundedSettingsCache::~BoundedSettingsCache() {
+    if (!flush()) {
+        qWarning() << "Discarding" << pending.size() << "modified settings groups that could not be written to the store";
+    }
+    processFilters.fetch_sub(int(evictedKeys.size()), std::memory_order_relaxed);
+    processFilterBytes.fetch_sub(filterBytes, std::memory_order_relaxed);
+}
+
+QVariant BoundedSettingsCache::value(const QString& group, const QString& key, const QVariant& defaultValue) {
+    QVariant result = defaultValue;
+    {
+        QMutexLocker locker(&mutex);
+        bool consulted = false;
+        if (!filteredOutLocked(group, key, &consulted)) {
+            const Entry& entry = entries[residentLocked(group)];
+            checkFilterLocked(consulted, entry, key);
+            result = entry.values.value(key, defaultValue);
+        }
+    }
+    writeBack();
+    return result;
+}
+
+bool BoundedSettingsCache::contains(const QString& group, const QString& key) {
+    bool result = false;
+    {
+        QMutexLocker locker(&mutex);
+        bool consulted = false;
+        if (!filteredOutLocked(group, key, &consulted)) {
+            const Entry& entry = entries[residentLocked(group)];
+            checkFilterLocked(consulted, entry, key);
+            result = entry.values.contains(key);
+        }
+    }
+    writeBack();
+    return result;
+}
+
+SettingsBackend::Group BoundedSettingsCache::group(const QString& group) {
+    SettingsBackend::Group result;
+    {
+        QMutexLocker locker(&mutex);
+        result = entries[residentLocked(group)].values;
+    }
+    writeBack();
+    return result;
+}
+
+void BoundedSettingsCache::setValue(const QString& group, const QString& key, const QVariant& value) {
+    {
+        QMutexLocker locker(&mutex);
+        const int slot = residentLocked(group);
+        Entry& entry = entries[slot];
+
+        auto it = entry.values.constFind(key);
+        if (it == entry.values.constEnd() || *it != value) {
+            qint64 delta = estimateBytes(key, value);
+            if (it != entry.values.constEnd()) delta -= estimateBytes(key, *it);
+            entry.values.insert(key, value);
+            markChanged(entry, key);
+            entry.bytes += delta;
+            residentBytes += delta;
+            evictLocked(slot);
+        }
+    }
+    writeBack();
+}
+
+void BoundedSettingsCache::remove(const QString& group, const QString& key) {
+    {
+        QMutexLocker locker(&mutex);
+        Entry& entry = entries[residentLocked(group)];
+        auto it = entry.values.find(key);
+        if (it != entry.values.end()) {
+            const qint64 delta = estimateBytes(key, *it);
+            entry.values.erase(it);
+            markChanged(entry, key);
+            entry.bytes -= delta;
+            residentBytes -= delta;
+        }
+    }
+    writeBack();
+}
+
+void BoundedSettingsCache::pin(const QString& group) {
+    {
+        QMutexLocker locker(&mutex);
+        entries[residentLocked(group)].pinned = true;
+    }
+    writeBack();
+}
+
+void BoundedSettingsCache::unpin(const QString& group) {
+    {
+        QMutexLocker locker(&mutex);
+        const int slot = index.value(group, -1);
+        if (slot < 0) return;
+        entries[slot].pinned = false;
+        evictLocked(-1);
+    }
+    writeBack();
+}
+
+bool BoundedSettingsCache::flush() {
+    {
+        QMutexLocker locker(&mutex);
+        for (Entry& entry : entries) {
+            if (entry.used && !entry.changedKeys.isEmpty()) queueWriteLocked(entry);
+        }
+    }
+    return writeBack(true);
+}
+
+bool BoundedSettingsCache::writeBack(bool force) {
+    if (pendingCount.loadAcquire() == 0) return true;
+    if (!force && retryCountdown.loadRelaxed() > 0) {
+        retryCountdown.fetchAndAddRelaxed(-1);
+        return false;
+    }
+    QMutexLocker writeLocker(&writeMutex);
+
+    SettingsCache::Snapshot values;
+    QSet<QString> groups;
+    QHash<QString, quint64> versions;
+    {
+        QMutexLocker locker(&mutex);
+        for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+            groups.insert(it.key());
+            versions.insert(it.key(), it->version);
+            if (!it->values.isEmpty()) values.insert(it.key(), it->values);
+        }
+    }
+    if (groups.isEmpty()) return true;
+
+    // Lookups of the queued groups are served from `pending` meanwhile
+    const bool ok = backend->save(values, groups);
+
+    QMutexLocker locker(&mutex);
+    if (!ok) {
+        qWarning() << "Cannot write" << groups.size() << "settings groups back to the store";
+        retryCountdown.storeRelaxed(WriteBackRetryInterval);
+        return false;
+    }
+    retryCountdown.storeRelaxed(0);
+    for (auto it = versions.cbegin(); it != versions.cend(); ++it) {
+        auto pendingIt = pending.find(it.key());
+        // Queued again while saving; the newer values go out with the next write-back
+        if (pendingIt == pending.end() || pendingIt->version != *it) continue;
+        pending.erase(pendingIt);
+    }
+    pendingCount.storeRelease(int(pending.size()));
+    return true;
+}
+
+void BoundedSettingsCache::setMemoryBudget(qint64 bytes) {
+    {
+        QMutexLocker locker(&mutex);
+        budget = bytes;
+        evictLocked(-1);
+    }
+    writeBack();
+}
+
+qint64 BoundedSettingsCache::memoryBudget() const {
+    QMutexLocker locker(&mutex);
+    return budget;
+}
+
+BoundedSettingsCache::Stats BoundedSettingsCache::stats() const {
+    QMutexLocker locker(&mutex);
+    Stats result;
+    result.hits = hits;
+    result.misses = misses;
+    result.evictions = evictions;
+    result.writeBacks = writeBacks;
+    result.filterRejects = filterRejects;
+    result.filterFalsePositives = filterFalsePositives;
+    result.filters = int(evictedKeys.size());
+    result.filterBytes = filterBytes;
+    result.residentGroups = int(index.size());
+    result.residentBytes = residentBytes;
+    result.pendingWrites = int(pending.size());
+    result.budget = budget;
+    return result;
+}
+
+void BoundedSettingsCache::resetStats() {
+    QMutexLocker locker(&mutex);
+    hits = misses = evictions = writeBacks = filterRejects = filterFalsePositives = 0;
+}
+
+BoundedSettingsCache::FilterTotals BoundedSettingsCache::filterTotals() {
+    FilterTotals totals;
+    totals.filters = processFilters.load(std::memory_order_relaxed);
+    totals.bytes = processFilterBytes.load(std::memory_order_relaxed);
+    return totals;
+}
+
+int BoundedSettingsCache::residentLocked(const QString& group) {
+    const int found = index.value(group, -1);
+    if (found >= 0) {
+        ++hits;
+        entries[found].referenced = true;
+        return found;
+    }
+
+    // Groups missing from the store are cached too, so repeated misses stay cheap
+    ++misses;
+    auto filterIt = evictedKeys.find(group);
+    if (filterIt != evictedKeys.end()) {
+        dropFilterLocked(filterIt);
+    }
+
+    Entry entry;
+    entry.group = group;
+    // A group still waiting for its write-back is newer than the store
+    auto pendingIt = pending.constFind(group);
+    entry.values = pendingIt != pending.constEnd() ? pendingIt->values : backend->loadGroup(group);
+    entry.original = entry.values;
+    entry.bytes = estimateBytes(group, entry.values);
+    entry.used = true;
+    entry.referenced = true;
+
+    int slot;
+    if (!freeSlots.isEmpty()) {
+        slot = freeSlots.takeLast();
+        entries[slot] = entry;
+    } else {
+        slot = int(entries.size());
+        entries.append(entry);
+    }
+    index.insert(group, slot);
+    residentBytes += entry.bytes;
+
+    evictLocked(slot);
+    return slot;
+}
+
+void BoundedSettingsCache::evictLocked(int keep) {
+    // Two full turns clear every reference bit; if that frees nothing, all the
+    // rest is pinned or in use
+    int steps = 2 * int(entries.size());
+    while (residentBytes > budget && steps-- > 0 && !entries.isEmpty()) {
+        hand = (hand + 1) % int(entries.size());
+        Entry& entry = entries[hand];
+        if (!entry.used || entry.pinned || hand == keep) continue;
+        if (entry.referenced) {
+            entry.referenced = false;
+            continue;
+        }
+        // Groups that were only read, or changed back, are dropped as they are
+        if (!entry.changedKeys.isEmpty()) {
+            queueWriteLocked(entry);
+            ++writeBacks;
+        }
+
+        index.remove(entry.group);
+        residentBytes -= entry.bytes;
+        rememberKeysLocked(entry);
+        entry = Entry();
+        freeSlots.append(hand);
+        ++evictions;
+    }
+}
+
+void BoundedSettingsCache::queueWriteLocked(Entry& entry) {
+    PendingWrite& write = pending[entry.group];
+    write.values = entry.values;
+    write.version = ++nextVersion;
+    pendingCount.storeRelease(int(pending.size()));
+
+    entry.original = entry.values;
+    entry.changedKeys.clear();
+}
+
+void BoundedSettingsCache::markChanged(Entry& entry, const QString& key) {
+    auto current = entry.values.constFind(key);
+    auto original = entry.original.constFind(key);
+    const bool hasCurrent = current != entry.values.constEnd();
+    const bool hasOriginal = original != entry.original.constEnd();
+    if (hasCurrent == hasOriginal && (!hasCurrent || *current == *original)) {
+        entry.changedKeys.remove(key);
+    } else {
+        entry.changedKeys.insert(key);
+    }
+}
+
+bool BoundedSettingsCache::filteredOutLocked(const QString& group, const QString& key, bool* consulted) {
+    if (index.contains(group)) return false;
+    auto it = evictedKeys.constFind(group);
+    if (it == evictedKeys.constEnd()) return false;
+    if (it->mightContain(key)) {
+        *consulted = true;
+        return false;
+    }
+
+    ++filterRejects;
+    SettingsMetrics::add(SettingsMetrics::FilterRejects);
+    return true;
+}
+
+void BoundedSettingsCache::checkFilterLocked(bool consulted, const Entry& entry, const QString& key) {
+    if (!consulted || entry.values.contains(key)) return;
+    ++filterFalsePositives;
+    SettingsMetrics::add(SettingsMetrics::FilterFalsePositives);
+}
+
+QHash<QString, SettingsBloomFilter>::iterator BoundedSettingsCache::dropFilterLocked(QHash<QString, SettingsBloomFilter>::iterator it) {
+    filterBytes -= it->memoryBytes();
+    processFilters.fetch_sub(1, std::memory_order_relaxed);
+    processFilterBytes.fetch_sub(it->memoryBytes(), std::memory_order_relaxed);
+    return evictedKeys.erase(it);
+}
+
+void BoundedSettingsCache::rememberKeysLocked(const Entry& entry) {
+    SettingsBloomFilter filter;
+    filter.reset(int(entry.values.size()));
+    for (auto it = entry.values.keyBegin(); it != entry.values.keyEnd(); ++it) {
+        filter.add(*it);
+    }
+
+    // Dropping a filter only costs a reload on the next miss
+    while (!evictedKeys.isEmpty() && filterBytes + filter.memoryBytes() > budget / 16) {
+        dropFilterLocked(evictedKeys.begin());
+    }
+    if (filter.memoryBytes() > budget / 16) return;
+    filterBytes += filter.memoryBytes();
+    processFilters.fetch_add(1, std::memory_order_relaxed);
+    processFilterBytes.fetch_add(filter.memoryBytes(), std::memory_order_relaxed);
+    evictedKeys.insert(entry.group, filter);
+}
+
+qint64 BoundedSettingsCache::estimateBytes(const QString& key, const QVariant& value) {
+    qint64 bytes = NodeOverhead + key.size() * qint64(sizeof(QChar));
+    switch (value.typeId()) {
+    case QMetaType::QString:
+        bytes += value.toString().size() * qint64(sizeof(QChar));
+        break;
+    case QMetaType::QByteArray:
+        bytes += value.toByteArray().size();
+        break;
+    case QMetaType::QStringList: {
+        const QStringList list = value.toStringList();
+        for (const QString& item : list) {
+            bytes += 32 + item.size() * qint64(sizeof(QChar));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return bytes;
+}
+
+qint64 BoundedSettingsCache::estimateBytes(const QString& group, const SettingsBackend::Group& values) {
+    qint64 bytes = EntryOverhead + group.size() * qint64(sizeof(QChar));
+    for (auto it = values.begin(); it != values.end(); ++it) {
+        bytes += estimateBytes(it.key(), it.value());
+    }
+    return bytes;
+}
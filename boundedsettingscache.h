@@ -0,0 +1,155 @@
+#ifndef BOUNDEDSETTINGSCACHE_H
+#define BOUNDEDSETTINGSCACHE_H
+
+#include "settingsbackend.h"
+#include "settingsbloomfilter.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QSet>
+
+// Alternative to SettingsCache for stores too large to keep in memory (e.g.
+// millions of per-entity groups): groups are loaded from the backend on first
+// use and kept within a memory budget, evicting with the CLOCK algorithm.
+// Groups that were only read, or whose edits were undone, are dropped without
+// touching the store; modified groups are written back when evicted or on
+// flush(). Write-backs are batched and run outside the cache lock, so lookups
+// of other groups are not blocked by disk I/O. Pinned groups are never
+// evicted. An evicted group leaves a Bloom filter of its keys behind, so
+// lookups of keys it does not have are answered without reloading it; this
+// assumes no other writer adds keys to the store meanwhile. Thread-safe.
+// settingsctl uses it for --memory-budget.
+class BoundedSettingsCache
+{
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        // Evictions that had to write a modified group back
+        quint64 writeBacks = 0;
+        // Lookups of evicted groups answered by their key filter
+        quint64 filterRejects = 0;
+        // Lookups a filter let through whose reloaded group lacked the key
+        quint64 filterFalsePositives = 0;
+        int filters = 0;
+        qint64 filterBytes = 0;
+        int residentGroups = 0;
+        qint64 residentBytes = 0;
+        // Evicted groups whose write-back has not finished yet
+        int pendingWrites = 0;
+        qint64 budget = 0;
+    };
+
+    // Takes ownership of `backend`. `memoryBudget` is in bytes of estimated heap use.
+    BoundedSettingsCache(SettingsBackend* backend, qint64 memoryBudget);
+    // Writes back modified groups; warns about any that could not be written
+    ~BoundedSettingsCache();
+
+    QVariant value(const QString& group, const QString& key, const QVariant& defaultValue = QVariant());
+    bool contains(const QString& group, const QString& key);
+    SettingsBackend::Group group(const QString& group);
+    void setValue(const QString& group, const QString& key, const QVariant& value);
+    void remove(const QString& group, const QString& key);
+
+    // Loads `group` if needed and keeps it resident until unpinned
+    void pin(const QString& group);
+    void unpin(const QString& group);
+
+    // Writes all modified groups in one backend save; retries at once even after
+    // a failed write-back
+    bool flush();
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    Stats stats() const;
+    void resetStats();
+
+    // Key filters held by all caches in the process, for the Diagnostics page
+    struct FilterTotals {
+        int filters = 0;
+        qint64 bytes = 0;
+    };
+    static FilterTotals filterTotals();
+
+private:
+    struct Entry {
+        QString group;
+        SettingsBackend::Group values;
+        // As loaded or last queued for write-back
+        SettingsBackend::Group original;
+        // Keys whose value differs from `original`; the entry is dirty while any are left
+        QSet<QString> changedKeys;
+        qint64 bytes = 0;
+        bool used = false;
+        // Set on every access, cleared as the clock hand passes
+        bool referenced = false;
+        bool pinned = false;
+    };
+
+    struct PendingWrite {
+        SettingsBackend::Group values;
+        // Tells a write-back whether the group was queued again while it ran
+        quint64 version = 0;
+    };
+
+    BoundedSettingsCache(const BoundedSettingsCache&) = delete;
+    BoundedSettingsCache& operator=(const BoundedSettingsCache&) = delete;
+
+    // Index of the resident entry for `group`, loading it on a miss
+    int residentLocked(const QString& group);
+    // Evicts unreferenced, unpinned entries other than `keep` until within budget
+    void evictLocked(int keep);
+    // Hands the entry's values to the next writeBack() and makes it clean
+    void queueWriteLocked(Entry& entry);
+    // Saves all queued groups in one backend call; takes `mutex` only to
+    // collect and retire them, never during the save. After a failed save,
+    // calls with `force` unset skip the next WriteBackRetryInterval attempts,
+    // so a broken store does not cost every lookup a disk write.
+    bool writeBack(bool force = false);
+    // True if `group` is evicted and its filter rules out `key`. `consulted` is
+    // set if a filter was asked and could not rule it out.
+    bool filteredOutLocked(const QString& group, const QString& key, bool* consulted);
+    // Counts a false positive if a filter let `key` through but `entry` lacks it
+    void checkFilterLocked(bool consulted, const Entry& entry, const QString& key);
+    void rememberKeysLocked(const Entry& entry);
+    QHash<QString, SettingsBloomFilter>::iterator dropFilterLocked(QHash<QString, SettingsBloomFilter>::iterator it);
+
+    static void markChanged(Entry& entry, const QString& key);
+    static qint64 estimateBytes(const QString& key, const QVariant& value);
+    static qint64 estimateBytes(const QString& group, const SettingsBackend::Group& values);
+
+    mutable QMutex mutex;
+    // Serializes backend saves; never taken while holding `mutex`
+    QMutex writeMutex;
+    QScopedPointer<SettingsBackend> backend;
+    qint64 budget;
+    qint64 residentBytes = 0;
+
+    // Clock ring; freed slots are reused before the ring grows
+    QList<Entry> entries;
+    QHash<QString, int> index;
+    QList<int> freeSlots;
+    int hand = 0;
+
+    // Evicted or flushed groups not yet in the store; lookups load them from
+    // here rather than from the backend
+    QHash<QString, PendingWrite> pending;
+    QAtomicInt pendingCount;
+    // Write-backs to skip before retrying a failed one
+    QAtomicInt retryCountdown;
+    quint64 nextVersion = 0;
+
+    // Key filters of evicted groups, kept within a sixteenth of the budget
+    QHash<QString, SettingsBloomFilter> evictedKeys;
+    qint64 filterBytes = 0;
+
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    quint64 writeBacks = 0;
+    quint64 filterRejects = 0;
+    quint64 filterFalsePositives = 0;
+};
+
+#endif // BOUNDEDSETTINGSCACHE_H
@@ -1,11 +1,4 @@
 #include "checkboxfactory.h"
-#include <QVariant>
 
-CheckBoxFactory::CheckBoxFactory(const QVariant& defaultValue)
-    : defaultValue_(defaultValue) {}
-
-QWidget* CheckBoxFactory::create() const {
-    QCheckBox* cb = new QCheckBox();
-    cb->setChecked(defaultValue_.toBool());
-    return cb;
-}
\ No newline at end of file
+CheckBoxFactory::CheckBoxFactory(bool defaultValue)
+    : TypedControlFactory(defaultValue) {}
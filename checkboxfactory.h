@@ -1,18 +1,18 @@
 #ifndef CHECKBOXFACTORY_H
 #define CHECKBOXFACTORY_H
 
-#include "settingscontrolfactory.h"
+#include "typedcontrolfactory.h"
 #include <QtWidgets/QCheckBox>
-#include <QVariant>
 
-class CheckBoxFactory : public SettingsControlFactory {
-public:
-    explicit CheckBoxFactory(const QVariant& defaultValue = false);
-
-    QWidget* create() const override;
+struct CheckBoxTraits {
+    static bool value(const QCheckBox* cb) { return cb->isChecked(); }
+    static void setValue(QCheckBox* cb, bool checked) { cb->setChecked(checked); }
+    static constexpr auto changedSignal = &QCheckBox::toggled;
+};
 
-private:
-    QVariant defaultValue_;
+class CheckBoxFactory : public TypedControlFactory<QCheckBox, bool, CheckBoxTraits> {
+public:
+    explicit CheckBoxFactory(bool defaultValue = false);
 };
 
-#endif // CHECKBOXFACTORY_H
\ No newline at end of file
+#endif // CHECKBOXFACTORY_H
@@ -2,36 +2,42 @@
 #include <QHBoxLayout>
 #include <QColor>
 
-ColorDialogFactory::ColorDialogFactory(LineEditFactory* lineEdit, PushButtonFactory* pushButton)
-    : lineEdit_(lineEdit), pushButton_(pushButton), lineEditWidget_(nullptr), pushButtonWidget_(nullptr) {}
-
-ColorDialogFactory::~ColorDialogFactory() {
-    delete lineEditWidget_;
-    delete pushButtonWidget_;
-}
+ColorDialogFactory::ColorDialogFactory(QSharedPointer<const LineEditFactory> lineEdit,
+                                       QSharedPointer<const PushButtonFactory> pushButton)
+    : lineEdit_(lineEdit), pushButton_(pushButton) {}
 
 QWidget* ColorDialogFactory::create() const {
     QWidget* container = new QWidget();
     QHBoxLayout* layout = new QHBoxLayout(container);
     layout->setContentsMargins(0, 0, 0, 0);
 
-    lineEditWidget_ = qobject_cast<QLineEdit*>(lineEdit_->create());
-    pushButtonWidget_ = qobject_cast<QPushButton*>(pushButton_->create());
+    QLineEdit* lineEdit = qobject_cast<QLineEdit*>(lineEdit_->create());
+    QPushButton* pushButton = qobject_cast<QPushButton*>(pushButton_->create());
 
-    layout->addWidget(lineEditWidget_, 1);
-    layout->addWidget(pushButtonWidget_);
+    layout->addWidget(lineEdit, 1);
+    layout->addWidget(pushButton);
 
-    QObject::connect(pushButtonWidget_, &QPushButton::clicked, [this]() {
+    QObject::connect(pushButton, &QPushButton::clicked, lineEdit, [lineEdit]() {
         QColorDialog dlg;
         dlg.setOption(QColorDialog::ShowAlphaChannel);
-        dlg.setCurrentColor(QColor(lineEditWidget_->text()));
+        dlg.setCurrentColor(QColor(lineEdit->text()));
         if (dlg.exec() == QDialog::Accepted) {
-            lineEditWidget_->setText(dlg.currentColor().name(QColor::HexArgb).toUpper());
+            lineEdit->setText(dlg.currentColor().name(QColor::HexArgb).toUpper());
         }
     });
 
     return container;
 }
 
-QLineEdit* ColorDialogFactory::getLineEdit() const { return lineEditWidget_; }
-QPushButton* ColorDialogFactory::getPushButton() const { return pushButtonWidget_; }
\ No newline at end of file
+QVariant ColorDialogFactory::value(const QWidget* control) const {
+    return lineEdit_->value(control->findChild<QLineEdit*>());
+}
+
+void ColorDialogFactory::setValue(QWidget* control, const QVariant& value) const {
+    lineEdit_->setValue(control->findChild<QLineEdit*>(), value);
+}
+
+QMetaObject::Connection ColorDialogFactory::connectValueChanged(QWidget* control, QObject* receiver,
+                                                                std::function<void()> slot) const {
+    return lineEdit_->connectValueChanged(control->findChild<QLineEdit*>(), receiver, std::move(slot));
+}
@@ -10,18 +10,18 @@
 
 class ColorDialogFactory : public SettingsControlFactory {
 public:
-    ColorDialogFactory(LineEditFactory* lineEdit, PushButtonFactory* pushButton);
-    ~ColorDialogFactory();
+    ColorDialogFactory(QSharedPointer<const LineEditFactory> lineEdit,
+                       QSharedPointer<const PushButtonFactory> pushButton);
     QWidget* create() const override;
 
-    QLineEdit* getLineEdit() const;
-    QPushButton* getPushButton() const;
+    QVariant value(const QWidget* control) const override;
+    void setValue(QWidget* control, const QVariant& value) const override;
+    QMetaObject::Connection connectValueChanged(QWidget* control, QObject* receiver,
+                                                std::function<void()> slot) const override;
 
 private:
-    LineEditFactory* lineEdit_;
-    PushButtonFactory* pushButton_;
-    mutable QLineEdit* lineEditWidget_;
-    mutable QPushButton* pushButtonWidget_;
+    QSharedPointer<const LineEditFactory> lineEdit_;
+    QSharedPointer<const PushButtonFactory> pushButton_;
 };
 
-#endif // COLORDIALOGFACTORY_H
\ No newline at end of file
+#endif // COLORDIALOGFACTORY_H
@@ -1,24 +1,40 @@
 #include "comboboxfactory.h"
+#include <QCompleter>
+#include <QListView>
 
 ComboBoxFactory::ComboBoxFactory(const QStringList& items, int defaultIndex)
-    : items_(items), defaultIndex_(defaultIndex)
-{
-    if (defaultIndex < 0 || defaultIndex >= items.size()) {
-        defaultIndex_ = 0;
-    }
-}
+    : TypedControlFactory(items.value(defaultIndex, items.value(0)))
+    , model_(QSharedPointer<SettingsOptionModel>::create(items)) {}
 
 ComboBoxFactory::ComboBoxFactory(const QString& defaultValue, const QStringList& items)
-    : items_(items), defaultIndex_(items.indexOf(defaultValue))
-{
-    if (defaultIndex_ == -1) {
-        defaultIndex_ = 0;
+    : TypedControlFactory(items.contains(defaultValue) ? defaultValue : items.value(0))
+    , model_(QSharedPointer<SettingsOptionModel>::create(items)) {}
+
+ComboBoxFactory::ComboBoxFactory(QSharedPointer<SettingsOptionModel> model,
+                                 const QString& defaultValue,
+                                 bool completer)
+    : TypedControlFactory(model->indexOf(defaultValue) >= 0 ? defaultValue : model->option(0))
+    , model_(model)
+    , completer_(completer) {}
+
+void ComboBoxFactory::configure(QComboBox* combo) const {
+    combo->setModel(model_.data());
+
+    // Sizing to contents would measure every option on first show
+    combo->setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLengthWithIcon);
+    combo->setMinimumContentsLength(20);
+    if (auto* view = qobject_cast<QListView*>(combo->view())) {
+        view->setUniformItemSizes(true);
     }
-}
 
-QWidget* ComboBoxFactory::create() const {
-    QComboBox* combo = new QComboBox();
-    combo->addItems(items_);
-    combo->setCurrentIndex(defaultIndex_);
-    return combo;
-}
\ No newline at end of file
+    if (completer_) {
+        combo->setEditable(true);
+        combo->setInsertPolicy(QComboBox::NoInsert);
+
+        QCompleter* completer = new QCompleter(model_.data(), combo);
+        completer->setCaseSensitivity(Qt::CaseInsensitive);
+        completer->setFilterMode(Qt::MatchContains);
+        completer->setCompletionMode(QCompleter::PopupCompletion);
+        combo->setCompleter(completer);
+    }
+}
@@ -1,21 +1,45 @@
 #ifndef COMBOBOXFACTORY_H
 #define COMBOBOXFACTORY_H
 
-#include "settingscontrolfactory.h"
+#include "typedcontrolfactory.h"
+#include "settingsoptionmodel.h"
 #include <QtWidgets/QComboBox>
 #include <QStringList>
 
-class ComboBoxFactory : public SettingsControlFactory {
+struct ComboBoxTraits {
+    static QString value(const QComboBox* combo) { return combo->itemText(combo->currentIndex()); }
+    static void setValue(QComboBox* combo, const QString& text) {
+        int index = -1;
+        if (auto* options = qobject_cast<const SettingsOptionModel*>(combo->model())) {
+            index = options->indexOf(text);
+        } else {
+            index = combo->findText(text);
+        }
+        if (index >= 0) combo->setCurrentIndex(index);
+    }
+    static constexpr auto changedSignal = &QComboBox::currentIndexChanged;
+};
+
+class ComboBoxFactory : public TypedControlFactory<QComboBox, QString, ComboBoxTraits> {
 public:
     explicit ComboBoxFactory(const QStringList& items, int defaultIndex = 0);
 
     explicit ComboBoxFactory(const QString& defaultValue, const QStringList& items);
 
-    QWidget* create() const override;
+    // All combo boxes created from factories sharing `model` display the same
+    // option set without copying it; `completer` enables type-ahead filtering.
+    explicit ComboBoxFactory(QSharedPointer<SettingsOptionModel> model,
+                             const QString& defaultValue = QString(),
+                             bool completer = false);
+
+    QSharedPointer<SettingsOptionModel> model() const { return model_; }
+
+protected:
+    void configure(QComboBox* combo) const override;
 
 private:
-    QStringList items_;
-    int defaultIndex_;
+    QSharedPointer<SettingsOptionModel> model_;
+    bool completer_ = false;
 };
 
-#endif // COMBOBOXFACTORY_H
\ No newline at end of file
+#endif // COMBOBOXFACTORY_H
@@ -1,36 +1,130 @@
 #include "filebrowsefactory.h"
+#include "pathprobe.h"
 #include <QHBoxLayout>
 #include <QFileDialog>
 #include <QDir>
+#include <QLabel>
+#include <QTimer>
+#include <QCompleter>
+#include <QStringListModel>
 
-FileBrowseFactory::FileBrowseFactory(LineEditFactory* lineEdit, PushButtonFactory* pushButton)
-    : lineEdit_(lineEdit), pushButton_(pushButton), lineEditWidget_(nullptr), pushButtonWidget_(nullptr) {}
+namespace {
+const int ProbeDebounceMs = 250;
+const char* ProbeTimerName = "probeTimer";
 
-FileBrowseFactory::~FileBrowseFactory() {
-    delete lineEditWidget_;
-    delete pushButtonWidget_;
+QString directoryOf(const QString& path) {
+    return path.left(path.lastIndexOf('/') + 1);
 }
 
+void showStatus(QLabel* label, const QString& path, const PathProbe::Status& status) {
+    if (path.isEmpty()) {
+        label->clear();
+        label->setToolTip(QString());
+    } else if (!status.exists) {
+        label->setText("✗");
+        label->setStyleSheet("color: #c62828;");
+        label->setToolTip("Path does not exist");
+    } else if (!status.readable) {
+        label->setText("!");
+        label->setStyleSheet("color: #ef6c00;");
+        label->setToolTip("Path is not readable");
+    } else {
+        label->setText("✓");
+        label->setStyleSheet("color: #2e7d32;");
+        label->setToolTip(QString("%1 exists%2")
+                              .arg(status.isDir ? "Directory" : "File")
+                              .arg(status.writable ? "" : " (read-only)"));
+    }
+}
+}
+
+FileBrowseFactory::FileBrowseFactory(QSharedPointer<const LineEditFactory> lineEdit,
+                                     QSharedPointer<const PushButtonFactory> pushButton)
+    : lineEdit_(lineEdit), pushButton_(pushButton) {}
+
 QWidget* FileBrowseFactory::create() const {
     QWidget* container = new QWidget();
     QHBoxLayout* layout = new QHBoxLayout(container);
     layout->setContentsMargins(0, 0, 0, 0);
 
-    lineEditWidget_ = qobject_cast<QLineEdit*>(lineEdit_->create());
-    pushButtonWidget_ = qobject_cast<QPushButton*>(pushButton_->create());
+    QLineEdit* lineEdit = qobject_cast<QLineEdit*>(lineEdit_->create());
+    QPushButton* pushButton = qobject_cast<QPushButton*>(pushButton_->create());
+
+    QLabel* statusLabel = new QLabel();
+    statusLabel->setFixedWidth(16);
+    statusLabel->setAlignment(Qt::AlignCenter);
 
-    layout->addWidget(lineEditWidget_, 1);
-    layout->addWidget(pushButtonWidget_);
+    layout->addWidget(lineEdit, 1);
+    layout->addWidget(statusLabel);
+    layout->addWidget(pushButton);
+
+    // Completion entries come from background enumeration of the typed directory
+    QStringListModel* completionModel = new QStringListModel(lineEdit);
+    QCompleter* completer = new QCompleter(completionModel, lineEdit);
+    completer->setCompletionMode(QCompleter::PopupCompletion);
+    lineEdit->setCompleter(completer);
+
+    // Validation and enumeration run once typing settles
+    QTimer* probeTimer = new QTimer(lineEdit);
+    probeTimer->setObjectName(ProbeTimerName);
+    probeTimer->setSingleShot(true);
+    probeTimer->setInterval(ProbeDebounceMs);
+    QObject::connect(lineEdit, &QLineEdit::textChanged, probeTimer, [probeTimer, statusLabel]() {
+        statusLabel->setText("…");
+        statusLabel->setStyleSheet("color: gray;");
+        probeTimer->start();
+    });
+
+    QObject::connect(probeTimer, &QTimer::timeout, lineEdit, [lineEdit, statusLabel, completionModel]() {
+        const QString path = QDir::fromNativeSeparators(lineEdit->text());
+        if (path.isEmpty()) {
+            showStatus(statusLabel, path, PathProbe::Status());
+            return;
+        }
 
-    QObject::connect(pushButtonWidget_, &QPushButton::clicked, [this]() {
+        PathProbe::instance().validate(path, lineEdit, [lineEdit, statusLabel, path](const PathProbe::Status& status) {
+            if (QDir::fromNativeSeparators(lineEdit->text()) == path) {
+                showStatus(statusLabel, path, status);
+            }
+        });
+
+        const QString dir = directoryOf(path);
+        if (dir.isEmpty() || completionModel->property("directory").toString() == dir) return;
+
+        PathProbe::instance().listDirectory(dir, lineEdit, [lineEdit, completionModel, dir](const QStringList& entries) {
+            // Listings can arrive out of order; keep only the one for the directory being typed
+            if (directoryOf(QDir::fromNativeSeparators(lineEdit->text())) != dir) return;
+            completionModel->setStringList(entries);
+            completionModel->setProperty("directory", dir);
+        });
+    });
+
+    QObject::connect(pushButton, &QPushButton::clicked, lineEdit, [lineEdit]() {
         QString path = QFileDialog::getOpenFileName(nullptr, "Select File", QDir::homePath());
         if (!path.isEmpty()) {
-            lineEditWidget_->setText(path);
+            lineEdit->setText(path);
         }
     });
 
+    // Check the initial text too, not only later edits
+    probeTimer->start();
     return container;
 }
 
-QLineEdit* FileBrowseFactory::getLineEdit() const { return lineEditWidget_; }
-QPushButton* FileBrowseFactory::getPushButton() const { return pushButtonWidget_; }
\ No newline at end of file
+QVariant FileBrowseFactory::value(const QWidget* control) const {
+    return lineEdit_->value(control->findChild<QLineEdit*>());
+}
+
+void FileBrowseFactory::setValue(QWidget* control, const QVariant& value) const {
+    QLineEdit* lineEdit = control->findChild<QLineEdit*>();
+    lineEdit_->setValue(lineEdit, value);
+    // setText() does not signal when the text is unchanged, so probe the loaded value explicitly
+    if (QTimer* probeTimer = lineEdit->findChild<QTimer*>(ProbeTimerName)) {
+        probeTimer->start();
+    }
+}
+
+QMetaObject::Connection FileBrowseFactory::connectValueChanged(QWidget* control, QObject* receiver,
+                                                               std::function<void()> slot) const {
+    return lineEdit_->connectValueChanged(control->findChild<QLineEdit*>(), receiver, std::move(slot));
+}
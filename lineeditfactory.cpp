@@ -1,10 +1,4 @@
 #include "lineeditfactory.h"
 
 LineEditFactory::LineEditFactory(const QString& defaultText)
-    : defaultText_(defaultText) {}
-
-QWidget* LineEditFactory::create() const {
-    QLineEdit* le = new QLineEdit();
-    le->setText(defaultText_);
-    return le;
-}
\ No newline at end of file
+    : TypedControlFactory(defaultText) {}
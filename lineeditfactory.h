@@ -1,17 +1,18 @@
 #ifndef LINEEDITFACTORY_H
 #define LINEEDITFACTORY_H
 
-#include "settingscontrolfactory.h"
+#include "typedcontrolfactory.h"
 #include <QtWidgets/QLineEdit>
 
-class LineEditFactory : public SettingsControlFactory {
+struct LineEditTraits {
+    static QString value(const QLineEdit* le) { return le->text(); }
+    static void setValue(QLineEdit* le, const QString& text) { le->setText(text); }
+    static constexpr auto changedSignal = &QLineEdit::textChanged;
+};
+
+class LineEditFactory : public TypedControlFactory<QLineEdit, QString, LineEditTraits> {
 public:
     explicit LineEditFactory(const QString& defaultText = "");
-
-    QWidget* create() const override;
-
-private:
-    QString defaultText_;
 };
 
-#endif // LINEEDITFACTORY_H
\ No newline at end of file
+#endif // LINEEDITFACTORY_H
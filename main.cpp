@@ -1,12 +1,59 @@
 #include <QApplication>
 #include "settingswindow.h"
+#include "settingscache.h"
+#include "settingssharedsegment.h"
+#include "settingsservice.h"
+#include "settingsprotocol.h"
+#include "settingsmetrics.h"
+#include "shardedsettingsbackend.h"
+#include "settingskeys.h"
+#include <QDebug>
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
+    // --diagnostics records SettingsMetrics and cache lock profiles and adds a Diagnostics page to the window
+    if (app.arguments().contains("--diagnostics")) {
+        SettingsMetrics::setEnabled(true);
+        SettingsCache::instance().setLockProfiling(true);
+    }
+
+    // --store-dir <dir> keeps one INI file per settings group in <dir> instead
+    // of the native TestLabs/TestSettings store
+    const int storeDirIndex = app.arguments().indexOf("--store-dir");
+    if (storeDirIndex >= 0) {
+        if (storeDirIndex + 1 < app.arguments().size()) {
+            SettingsCache::instance().setBackend(new ShardedSettingsBackend(app.arguments().at(storeDirIndex + 1)));
+        } else {
+            qWarning() << "--store-dir needs a directory";
+        }
+    }
+
+    // Typed accessors in settingskeys.h read by slot
+    SettingsKeys::install();
+
+    // --publish-shared makes this instance the writer of the shared-memory
+    // segment that other processes (e.g. "settingsctl peek") read from
+    SettingsSharedSegment segment;
+    if (app.arguments().contains("--publish-shared")) {
+        if (segment.create()) {
+            SettingsCache::instance().setSharedSegment(&segment);
+        } else {
+            qWarning() << "Cannot create shared settings segment:" << segment.errorString();
+        }
+    }
+
+    // --serve exposes the live settings to other local processes (see settingsload)
+    SettingsService service;
+    if (app.arguments().contains("--serve") && !service.listen(SettingsProtocol::DefaultServerName)) {
+        qWarning() << "Cannot start settings service:" << service.errorString();
+    }
+
     SettingsWindow window;
     window.show();
     
-    return app.exec();
+    const int result = app.exec();
+    SettingsCache::instance().setSharedSegment(nullptr);
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "nativesettingsbackend.h"
+#include "settingsinireader.h"
+#include "settingsmetrics.h"
+#include "settingsstringpool.h"
+#include <QSettings>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+NativeSettingsBackend::NativeSettingsBackend(const QString& organization, const QString& application)
+    : organization_(organization), application_(application) {}
+
+SettingsCache::Snapshot NativeSettingsBackend::load() {
+    QSettings settings(organization_, application_);
+
+    SettingsCache::Snapshot values;
+    // The native format on Linux is an INI file; read it without QSettings'
+    // own parse and the per-key value() copies
+    if (isIniFile(settings) && SettingsIniReader::read(settings.fileName(), &values)) {
+        return values;
+    }
+    values.clear();
+
+    // Otherwise the system-wide values would be reported as user values
+    settings.setFallbacksEnabled(false);
+
+    const QStringList groups = settings.childGroups();
+    for (const QString& group : groups) {
+        settings.beginGroup(group);
+        const QStringList keys = settings.childKeys();
+        if (!keys.isEmpty()) {
+            Group& groupValues = values[SettingsStringPool::shared(group)];
+            for (const QString& key : keys) {
+                groupValues.insert(SettingsStringPool::shared(key), settings.value(key));
+            }
+        }
+        settings.endGroup();
+    }
+    return values;
+}
+
+SettingsBackend::Group NativeSettingsBackend::loadGroup(const QString& group) {
+    QSettings settings(organization_, application_);
+
+    SettingsCache::Snapshot iniValues;
+    if (isIniFile(settings) && SettingsIniReader::read(settings.fileName(), &iniValues, group)) {
+        return iniValues.value(group);
+    }
+
+    settings.setFallbacksEnabled(false);
+    settings.beginGroup(group);
+
+    Group values;
+    const QStringList keys = settings.childKeys();
+    for (const QString& key : keys) {
+        values.insert(SettingsStringPool::shared(key), settings.value(key));
+    }
+    return values;
+}
+
+bool NativeSettingsBackend::save(const SettingsCache::Snapshot& values, const QSet<QString>& dirtyGroups) {
+    if (dirtyGroups.isEmpty()) return true;
+
+    QSettings settings(organization_, application_);
+    settings.setFallbacksEnabled(false);
+
+    for (const QString& group : dirtyGroups) {
+        settings.remove(group);
+        auto groupIt = values.find(group);
+        if (groupIt == values.end()) continue;
+
+        settings.beginGroup(group);
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            settings.setValue(keyIt.key(), keyIt.value());
+        }
+        settings.endGroup();
+    }
+
+    settings.sync();
+    // The file formats rewrite the whole file; the registry has no size to report
+    if (SettingsMetrics::isEnabled() && QFileInfo::exists(settings.fileName())) {
+        SettingsMetrics::add(SettingsMetrics::BytesWritten, quint64(QFileInfo(settings.fileName()).size()));
+    }
+    return settings.status() == QSettings::NoError;
+}
+
+bool NativeSettingsBackend::isIniFile(const QSettings& settings) {
+#if defined(Q_OS_UNIX) && !defined(Q_OS_DARWIN)
+    return settings.format() == QSettings::NativeFormat || settings.format() == QSettings::IniFormat;
+#else
+    return settings.format() == QSettings::IniFormat;
+#endif
+}
+
+QString NativeSettingsBackend::journalFileName() const {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation)
+           + '/' + organization_ + '/' + application_ + ".journal";
+}
+
+QStringList NativeSettingsBackend::watchPaths() const {
+    QSettings settings(organization_, application_);
+    // On Windows the native store is the registry and there is no file to watch
+    return { settings.fileName(), journalFileName() };
+}
@@ -0,0 +1,28 @@
+#ifndef NATIVESETTINGSBACKEND_H
+#define NATIVESETTINGSBACKEND_H
+
+#include "settingsbackend.h"
+
+class QSettings;
+
+// Single QSettings store in the platform's native format (registry, plist, INI)
+class NativeSettingsBackend : public SettingsBackend
+{
+public:
+    NativeSettingsBackend(const QString& organization, const QString& application);
+
+    SettingsCache::Snapshot load() override;
+    Group loadGroup(const QString& group) override;
+    bool save(const SettingsCache::Snapshot& values, const QSet<QString>& dirtyGroups) override;
+    QString journalFileName() const override;
+    QStringList watchPaths() const override;
+
+private:
+    // Whether `settings` is backed by an INI file SettingsIniReader can read
+    static bool isIniFile(const QSettings& settings);
+
+    QString organization_;
+    QString application_;
+};
+
+#endif // NATIVESETTINGSBACKEND_H
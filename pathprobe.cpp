@@ -0,0 +1,85 @@
+#include "pathprobe.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QPointer>
+
+namespace {
+// Listings older than this are enumerated again
+const qint64 ListingTtlMs = 10000;
+}
+
+PathProbe& PathProbe::instance() {
+    static PathProbe instance;
+    return instance;
+}
+
+PathProbe::PathProbe(QObject* parent)
+    : QObject(parent)
+{
+    // A hung network mount must not starve QThreadPool::globalInstance()
+    pool.setMaxThreadCount(2);
+    // Cost is counted in directory entries
+    listings.setMaxCost(50000);
+}
+
+PathProbe::~PathProbe() {
+    pool.clear();
+    pool.waitForDone();
+}
+
+void PathProbe::setCacheCapacity(int entries) {
+    QMutexLocker locker(&cacheMutex);
+    listings.setMaxCost(entries);
+}
+
+void PathProbe::listDirectory(const QString& dir, QObject* receiver,
+                              std::function<void(const QStringList&)> callback) {
+    {
+        QMutexLocker locker(&cacheMutex);
+        if (const Listing* cached = listings.object(dir)) {
+            if (QDateTime::currentMSecsSinceEpoch() - cached->loadedAt < ListingTtlMs) {
+                QStringList entries = cached->entries;
+                locker.unlock();
+                callback(entries);
+                return;
+            }
+        }
+    }
+
+    QPointer<QObject> guard(receiver);
+    pool.start([this, dir, guard, callback]() {
+        QStringList entries;
+        const QFileInfoList infos = QDir(dir).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot, QDir::Name);
+        entries.reserve(infos.size());
+        for (const QFileInfo& info : infos) {
+            entries.append(info.isDir() ? info.filePath() + '/' : info.filePath());
+        }
+
+        {
+            QMutexLocker locker(&cacheMutex);
+            listings.insert(dir, new Listing{entries, QDateTime::currentMSecsSinceEpoch()}, entries.size() + 1);
+        }
+
+        QMetaObject::invokeMethod(this, [guard, callback, entries]() {
+            if (guard) callback(entries);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void PathProbe::validate(const QString& path, QObject* receiver,
+                         std::function<void(const Status&)> callback) {
+    QPointer<QObject> guard(receiver);
+    pool.start([this, path, guard, callback]() {
+        QFileInfo info(path);
+        Status status;
+        status.exists = info.exists();
+        status.isDir = info.isDir();
+        status.readable = info.isReadable();
+        status.writable = info.isWritable();
+
+        QMetaObject::invokeMethod(this, [guard, callback, status]() {
+            if (guard) callback(status);
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,50 @@
+#ifndef PATHPROBE_H
+#define PATHPROBE_H
+
+#include <QObject>
+#include <QCache>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <functional>
+
+// Runs filesystem queries for path controls on worker threads so the GUI thread
+// never blocks on slow or large directories. Results are delivered on the thread
+// that owns PathProbe and dropped if the receiver has been destroyed meanwhile.
+class PathProbe : public QObject
+{
+public:
+    struct Status {
+        bool exists = false;
+        bool isDir = false;
+        bool readable = false;
+        bool writable = false;
+    };
+
+    static PathProbe& instance();
+
+    void listDirectory(const QString& dir, QObject* receiver,
+                       std::function<void(const QStringList&)> callback);
+    void validate(const QString& path, QObject* receiver,
+                  std::function<void(const Status&)> callback);
+
+    void setCacheCapacity(int entries);
+
+private:
+    struct Listing {
+        QStringList entries;
+        qint64 loadedAt = 0;
+    };
+
+    PathProbe(QObject* parent = nullptr);
+    ~PathProbe();
+
+    PathProbe(const PathProbe&) = delete;
+    PathProbe& operator=(const PathProbe&) = delete;
+
+    QThreadPool pool;
+    QMutex cacheMutex;
+    QCache<QString, Listing> listings;
+};
+
+#endif // PATHPROBE_H
@@ -0,0 +1,29 @@
+#ifndef SETTINGSBACKEND_H
+#define SETTINGSBACKEND_H
+
+#include "settingscache.h"
+#include <QSet>
+
+// Persistent store behind the user scope of SettingsCache.
+class SettingsBackend
+{
+public:
+    using Group = QMap<QString, QVariant>;
+
+    virtual ~SettingsBackend() = default;
+
+    virtual SettingsCache::Snapshot load() = 0;
+    virtual Group loadGroup(const QString& group) = 0;
+
+    // Writes the groups listed in `dirtyGroups`; a dirty group that is missing
+    // from `values` is deleted from the store
+    virtual bool save(const SettingsCache::Snapshot& values, const QSet<QString>& dirtyGroups) = 0;
+
+    // Where the write-ahead journal for this store lives
+    virtual QString journalFileName() const = 0;
+
+    // Files whose modification means the store was changed from outside
+    virtual QStringList watchPaths() const = 0;
+};
+
+#endif // SETTINGSBACKEND_H
@@ -0,0 +1,451 @@
+#include "settingsinireader.h"
+#include "settingslock.h"
+#include "settingsschemaloader.h"
+#include "settingsstringpool.h"
+#include "shardedsettingsbackend.h"
+#include <QCborMap>
+#include <QCborArray>
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QScopedPointer>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// Micro-benchmarks for settings_core. Each benchmark runs its workload --runs
+// times and reports the median, so one slow run (page faults, a busy core)
+// does not skew the result.
+//
+//   settingsbench schema|ini|contention|scaling|memory [--settings n] [--runs n]
+//                 [--threads n] [--duration ms] [--writes percent]
+//
+// schema: parses a generated schema of n settings (default 20000) from
+//         memory, as JSON and as CBOR
+// ini:    loads an INI store of n settings with QSettings and with
+//         SettingsIniReader
+// contention: --threads writer threads call setValue() while the main thread
+//         keeps calling saveToSettings() for --duration ms; prints the cache
+//         lock profile per call site. Uses a scratch sharded store.
+// scaling: cache operations per second with 1, 2, 4, ... up to --threads
+//         threads, each doing --writes percent setValue() and getValue() otherwise
+// memory: heap used by a parsed store of n settings (e.g. --settings 100000)
+//         before and after loading a schema with the same ids, whose interned
+//         strings the store then shares; needs glibc for the heap figures
+
+namespace {
+
+QTextStream& out() {
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+struct Options {
+    int settings = 0;
+    int runs = 0;
+    int threads = 0;
+    int durationMs = 0;
+    int writes = 0;
+};
+
+qint64 median(QList<qint64> samples) {
+    if (samples.isEmpty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+QString ms(qint64 ns) {
+    return QString::number(ns / 1e6, 'f', 2) + " ms";
+}
+
+QString us(quint64 ns) {
+    return QString::number(ns / 1e3, 'f', 1);
+}
+
+// Bytes of heap in use, or -1 where the C library cannot tell
+qint64 heapInUse() {
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+    return qint64(mallinfo2().uordblks);
+#endif
+#endif
+    return -1;
+}
+
+QString kib(qint64 bytes) {
+    return bytes < 0 ? QStringLiteral("n/a") : QString::number(bytes / 1024.0, 'f', 1) + " KiB";
+}
+
+// Fills the user scope of a cache backed by a sharded store in `directory`
+void prepareCache(SettingsCache& cache, const QString& directory, int settings) {
+    cache.setBackend(new ShardedSettingsBackend(directory));
+    cache.loadFromSettings();
+    SettingsCache::Snapshot values;
+    for (int i = 0; i < settings; ++i) {
+        values[QStringLiteral("group_%1").arg(i / 100)].insert(QString::number(i), i);
+    }
+    cache.restore(values);
+    cache.saveToSettings();
+}
+
+// `setup` runs before every run and is not timed
+template <typename Setup, typename Workload>
+qint64 measure(int runs, Setup setup, Workload workload) {
+    QList<qint64> samples;
+    QElapsedTimer timer;
+    for (int run = 0; run < runs; ++run) {
+        setup(run);
+        timer.start();
+        workload(run);
+        samples.append(timer.nsecsElapsed());
+    }
+    return median(samples);
+}
+
+template <typename Workload>
+qint64 measure(int runs, Workload workload) {
+    return measure(runs, [](int) {}, [&workload](int) { workload(); });
+}
+
+// 100 settings per group; "items" goes last, as the CBOR reader requires
+QCborMap generateSchema(int settings) {
+    const int perGroup = 100;
+    QCborArray groups;
+    for (int first = 0; first < settings; first += perGroup) {
+        QCborArray items;
+        for (int i = first; i < std::min(settings, first + perGroup); ++i) {
+            QCborMap item;
+            item.insert(QStringLiteral("id"), QString::number(i));
+            item.insert(QStringLiteral("name"), QStringLiteral("Setting %1").arg(i));
+            item.insert(QStringLiteral("description"), QStringLiteral("Generated setting %1").arg(i));
+            item.insert(QStringLiteral("default"), i);
+            item.insert(QStringLiteral("control"), QStringLiteral("spinbox"));
+            QCborMap options;
+            options.insert(QStringLiteral("min"), 0);
+            options.insert(QStringLiteral("max"), settings);
+            item.insert(QStringLiteral("options"), options);
+            items.append(item);
+        }
+
+        QCborMap group;
+        group.insert(QStringLiteral("id"), QStringLiteral("group_%1").arg(first / perGroup));
+        group.insert(QStringLiteral("name"), QStringLiteral("Group %1").arg(first / perGroup));
+        group.insert(QStringLiteral("items"), items);
+        groups.append(group);
+    }
+
+    QCborMap root;
+    root.insert(QStringLiteral("id"), QStringLiteral("root"));
+    root.insert(QStringLiteral("name"), QStringLiteral("Settings"));
+    root.insert(QStringLiteral("items"), groups);
+    return root;
+}
+
+int benchSchema(const Options& options) {
+    const QCborMap schema = generateSchema(options.settings);
+    const QByteArray json = QJsonDocument(schema.toJsonObject()).toJson(QJsonDocument::Compact);
+    const QByteArray cbor = schema.toCborValue().toCbor();
+
+    bool ok = true;
+    auto load = [&ok](const QByteArray& data, bool isCbor) {
+        SettingsSchemaLoader loader;
+        QScopedPointer<SettingsItem> root(isCbor ? loader.loadCbor(data) : loader.loadJson(data));
+        if (!root) {
+            err() << "schema load failed: " << loader.errorString() << '\n';
+            ok = false;
+        }
+    };
+
+    const qint64 jsonNs = measure(options.runs, [&]() { load(json, false); });
+    const qint64 cborNs = measure(options.runs, [&]() { load(cbor, true); });
+    if (!ok) return 1;
+
+    out() << "schema:     " << options.settings << " settings, median of " << options.runs << " runs\n"
+          << "json:       " << ms(jsonNs) << " (" << json.size() / 1024 << " KiB)\n"
+          << "cbor:       " << ms(cborNs) << " (" << cbor.size() / 1024 << " KiB)\n";
+    return 0;
+}
+
+int benchIni(const Options& options) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err() << "cannot create a temporary directory\n";
+        return 1;
+    }
+
+    // Same layout as the native store: one section per group, 100 keys each
+    const QString source = dir.filePath("source.ini");
+    {
+        QSettings settings(source, QSettings::IniFormat);
+        for (int i = 0; i < options.settings; ++i) {
+            settings.setValue(QStringLiteral("group_%1/%2").arg(i / 100).arg(i),
+                              i % 3 == 0 ? QVariant(i) : QVariant(QStringLiteral("value %1").arg(i)));
+        }
+        settings.sync();
+    }
+
+    // QSettings caches parsed files per name, so every run reads a fresh copy
+    auto copy = [&dir, &source](const QString& prefix) {
+        return [&dir, &source, prefix](int run) {
+            QFile::copy(source, dir.filePath(QStringLiteral("%1%2.ini").arg(prefix).arg(run)));
+        };
+    };
+
+    int settingsCount = 0;
+    const qint64 qsettingsNs = measure(options.runs, copy("qsettings"), [&](int run) {
+        QSettings settings(dir.filePath(QStringLiteral("qsettings%1.ini").arg(run)), QSettings::IniFormat);
+        SettingsCache::Snapshot values;
+        const QStringList groups = settings.childGroups();
+        for (const QString& group : groups) {
+            settings.beginGroup(group);
+            const QStringList keys = settings.childKeys();
+            for (const QString& key : keys) {
+                values[group].insert(key, settings.value(key));
+            }
+            settings.endGroup();
+        }
+        settingsCount = 0;
+        for (const auto& group : std::as_const(values)) settingsCount += group.size();
+    });
+
+    int readerCount = 0;
+    bool ok = true;
+    const qint64 readerNs = measure(options.runs, copy("reader"), [&](int run) {
+        SettingsCache::Snapshot values;
+        ok = SettingsIniReader::read(dir.filePath(QStringLiteral("reader%1.ini").arg(run)), &values) && ok;
+        readerCount = 0;
+        for (const auto& group : std::as_const(values)) readerCount += group.size();
+    });
+
+    if (!ok || readerCount != settingsCount) {
+        err() << "SettingsIniReader read " << readerCount << " settings, QSettings " << settingsCount << '\n';
+        return 1;
+    }
+
+    out() << "ini:        " << options.settings << " settings, median of " << options.runs << " runs\n"
+          << "qsettings:  " << ms(qsettingsNs) << '\n'
+          << "inireader:  " << ms(readerNs) << '\n';
+    return 0;
+}
+
+int benchContention(const Options& options) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err() << "cannot create a temporary directory\n";
+        return 1;
+    }
+
+    SettingsCache& cache = SettingsCache::instance();
+    prepareCache(cache, dir.path(), options.settings);
+    cache.setLockProfiling(true);
+    cache.resetLockProfile();
+
+    std::atomic<bool> stop{false};
+    std::atomic<quint64> writes{0};
+    QList<QThread*> writers;
+    for (int t = 0; t < options.threads; ++t) {
+        writers.append(QThread::create([&cache, &stop, &writes, &options]() {
+            QRandomGenerator random(QRandomGenerator::global()->generate());
+            quint64 count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const int i = int(random.bounded(options.settings));
+                cache.setValue(QStringLiteral("group_%1").arg(i / 100), QString::number(i), int(count));
+                ++count;
+            }
+            writes += count;
+        }));
+        writers.last()->start();
+    }
+
+    QList<qint64> saves;
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    while (total.elapsed() < options.durationMs) {
+        timer.start();
+        cache.saveToSettings();
+        saves.append(timer.nsecsElapsed());
+    }
+    stop = true;
+    for (QThread* writer : std::as_const(writers)) {
+        writer->wait();
+        delete writer;
+    }
+    const double seconds = std::max<qint64>(1, total.nsecsElapsed()) / 1e9;
+    cache.setLockProfiling(false);
+
+    out() << "contention: " << options.settings << " settings, " << options.threads << " writers, "
+          << options.durationMs << " ms\n"
+          << "writes:     " << QString::number(writes / seconds, 'f', 0) << " setValue/s\n"
+          << "saves:      " << saves.size() << ", median " << ms(median(saves)) << '\n'
+          << "lock sites (us): count, contended, wait avg/max, hold avg/max\n";
+    const QList<SettingsLock::SiteProfile> sites = cache.lockProfile();
+    for (const SettingsLock::SiteProfile& site : sites) {
+        const quint64 count = std::max<quint64>(1, site.acquisitions);
+        out() << "  " << site.site << (site.mode == SettingsLock::Write ? " write " : " read ")
+              << site.acquisitions << ", " << site.contended << ", "
+              << us(site.waitNs / count) << '/' << us(site.maxWaitNs) << ", "
+              << us(site.holdNs / count) << '/' << us(site.maxHoldNs) << '\n';
+    }
+    return 0;
+}
+
+int benchScaling(const Options& options) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err() << "cannot create a temporary directory\n";
+        return 1;
+    }
+
+    SettingsCache& cache = SettingsCache::instance();
+    prepareCache(cache, dir.path(), options.settings);
+
+    // Keys are built up front so the loop measures the cache, not QString::arg
+    QList<QPair<QString, QString>> keys;
+    keys.reserve(options.settings);
+    for (int i = 0; i < options.settings; ++i) {
+        keys.append({QStringLiteral("group_%1").arg(i / 100), QString::number(i)});
+    }
+
+    out() << "scaling:    " << options.settings << " settings, " << options.writes << "% writes, "
+          << options.durationMs << " ms per step\n";
+    QList<int> steps;
+    for (int threads = 1; threads < options.threads; threads *= 2) steps.append(threads);
+    steps.append(options.threads);
+
+    double single = 0;
+    for (int threads : std::as_const(steps)) {
+        std::atomic<bool> stop{false};
+        std::atomic<quint64> operations{0};
+        QList<QThread*> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.append(QThread::create([&]() {
+                QRandomGenerator random(QRandomGenerator::global()->generate());
+                quint64 count = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const QPair<QString, QString>& key = keys[int(random.bounded(options.settings))];
+                    if (int(random.bounded(100)) < options.writes) {
+                        cache.setValue(key.first, key.second, int(count));
+                    } else {
+                        cache.getValue(key.first, key.second);
+                    }
+                    ++count;
+                }
+                operations += count;
+            }));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        for (QThread* worker : std::as_const(workers)) worker->start();
+        QThread::msleep(options.durationMs);
+        stop = true;
+        for (QThread* worker : std::as_const(workers)) {
+            worker->wait();
+            delete worker;
+        }
+
+        const double rate = operations / (std::max<qint64>(1, timer.nsecsElapsed()) / 1e9);
+        if (threads == 1) single = rate;
+        out() << "  " << threads << " threads: " << QString::number(rate, 'f', 0) << " ops/s, "
+              << QString::number(rate / std::max(1.0, single), 'f', 2) << "x\n";
+    }
+    return 0;
+}
+
+int benchMemory(const Options& options) {
+    QByteArray ini;
+    for (int first = 0; first < options.settings; first += 100) {
+        ini += "[group_" + QByteArray::number(first / 100) + "]\n";
+        for (int i = first; i < std::min(options.settings, first + 100); ++i) {
+            ini += QByteArray::number(i) + '=' + QByteArray::number(i) + '\n';
+        }
+    }
+
+    // Parsed before the schema, every group and key is a private copy
+    SettingsCache::Snapshot unshared;
+    qint64 before = heapInUse();
+    if (!SettingsIniReader::parse(ini, &unshared)) {
+        err() << "cannot parse the generated store\n";
+        return 1;
+    }
+    const qint64 unsharedBytes = before < 0 ? -1 : heapInUse() - before;
+
+    SettingsSchemaLoader loader;
+    QScopedPointer<SettingsItem> root(loader.loadCbor(generateSchema(options.settings).toCborValue().toCbor()));
+    if (!root) {
+        err() << "schema load failed: " << loader.errorString() << '\n';
+        return 1;
+    }
+    const SettingsStringPool::Stats schemaPool = SettingsStringPool::stats();
+
+    SettingsCache::Snapshot shared;
+    before = heapInUse();
+    SettingsIniReader::parse(ini, &shared);
+    const qint64 sharedBytes = before < 0 ? -1 : heapInUse() - before;
+    const SettingsStringPool::Stats pool = SettingsStringPool::stats();
+
+    out() << "memory:     " << options.settings << " settings\n"
+          << "pool:       " << schemaPool.strings << " strings, " << kib(schemaPool.bytes)
+          << " after loading the schema\n"
+          << "unshared:   " << kib(unsharedBytes) << " for the parsed store\n"
+          << "shared:     " << kib(sharedBytes) << " for the parsed store, "
+          << pool.hits - schemaPool.hits << " strings shared, pool grew by "
+          << pool.strings - schemaPool.strings << " strings\n";
+    if (unsharedBytes >= 0) {
+        out() << "saved:      " << kib(unsharedBytes - sharedBytes) << '\n';
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micro-benchmarks for the settings core");
+    parser.addHelpOption();
+    parser.addPositionalArgument("benchmark", "One of: schema, ini, contention, scaling, memory.");
+    QCommandLineOption settingsOption("settings", "Number of settings.", "n", "20000");
+    QCommandLineOption runsOption("runs", "Repetitions; the median is reported.", "n", "5");
+    QCommandLineOption threadsOption("threads", "Writer threads.", "n", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption durationOption("duration", "Duration of timed benchmarks.", "ms", "2000");
+    QCommandLineOption writesOption("writes", "Percentage of setValue() calls in scaling.", "percent", "10");
+    parser.addOptions({settingsOption, runsOption, threadsOption, durationOption, writesOption});
+    parser.process(app);
+
+    Options options;
+    options.settings = std::max(1, parser.value(settingsOption).toInt());
+    options.runs = std::max(1, parser.value(runsOption).toInt());
+    options.threads = std::max(1, parser.value(threadsOption).toInt());
+    options.durationMs = std::max(1, parser.value(durationOption).toInt());
+    options.writes = std::clamp(parser.value(writesOption).toInt(), 0, 100);
+
+    const QStringList positional = parser.positionalArguments();
+    const QString benchmark = positional.value(0);
+    if (benchmark == "schema") return benchSchema(options);
+    if (benchmark == "ini") return benchIni(options);
+    if (benchmark == "contention") return benchContention(options);
+    if (benchmark == "scaling") return benchScaling(options);
+    if (benchmark == "memory") return benchMemory(options);
+
+    err() << "unknown benchmark '" << benchmark << "'\n";
+    parser.showHelp(2);
+}
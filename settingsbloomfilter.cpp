@@ -0,0 +1,58 @@
+#include "settingsbloomfilter.h"
+#include <QHash>
+#include <cmath>
+
+namespace {
+// Second, independent hash derived from the first (splitmix64 finalizer)
+quint64 mix(quint64 hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+}
+
+void SettingsBloomFilter::reset(int capacity) {
+    capacity_ = qMax(capacity, 8);
+    count_ = 0;
+
+    // Power-of-two number of bits, so a probe is a mask instead of a division
+    quint64 bitCount = 64;
+    while (bitCount < quint64(capacity_) * BitsPerKey) bitCount <<= 1;
+    mask = bitCount - 1;
+    bits = QList<quint64>(qsizetype(bitCount / 64), 0);
+}
+
+void SettingsBloomFilter::add(QStringView key) {
+    if (bits.isEmpty()) reset(0);
+
+    // Double hashing: probe i is h1 + i * h2
+    const quint64 h1 = quint64(qHash(key, 0));
+    const quint64 h2 = mix(h1) | 1;
+    quint64* words = bits.data();
+    for (int i = 0; i < HashCount; ++i) {
+        const quint64 bit = (h1 + quint64(i) * h2) & mask;
+        words[bit >> 6] |= quint64(1) << (bit & 63);
+    }
+    ++count_;
+}
+
+bool SettingsBloomFilter::mightContain(QStringView key) const {
+    if (bits.isEmpty()) return true;
+
+    const quint64 h1 = quint64(qHash(key, 0));
+    const quint64 h2 = mix(h1) | 1;
+    const quint64* words = bits.constData();
+    for (int i = 0; i < HashCount; ++i) {
+        const quint64 bit = (h1 + quint64(i) * h2) & mask;
+        if (!(words[bit >> 6] & (quint64(1) << (bit & 63)))) return false;
+    }
+    return true;
+}
+
+double SettingsBloomFilter::expectedFalsePositiveRate() const {
+    if (bits.isEmpty() || count_ == 0) return 0.0;
+    const double bitCount = double(mask + 1);
+    return std::pow(1.0 - std::exp(-HashCount * double(count_) / bitCount), HashCount);
+}
@@ -0,0 +1,37 @@
+#ifndef SETTINGSBLOOMFILTER_H
+#define SETTINGSBLOOMFILTER_H
+
+#include <QList>
+#include <QStringView>
+
+// Bloom filter over the keys of one group. mightContain() never returns false
+// for an added key, so a false answer is a definite miss. Keys cannot be taken
+// out again; the owner rebuilds the filter once too many of its keys are stale.
+class SettingsBloomFilter
+{
+public:
+    // About 1% false positives at full capacity
+    static constexpr int BitsPerKey = 10;
+    static constexpr int HashCount = 7;
+
+    // Empties the filter and sizes it for `capacity` keys
+    void reset(int capacity);
+    void add(QStringView key);
+    // An empty (never reset) filter cannot rule anything out
+    bool mightContain(QStringView key) const;
+
+    int capacity() const { return capacity_; }
+    int count() const { return count_; }
+    bool isFull() const { return count_ >= capacity_; }
+    qsizetype memoryBytes() const { return bits.size() * qsizetype(sizeof(quint64)); }
+    // For the keys added so far
+    double expectedFalsePositiveRate() const;
+
+private:
+    QList<quint64> bits;
+    quint64 mask = 0;
+    int capacity_ = 0;
+    int count_ = 0;
+};
+
+#endif // SETTINGSBLOOMFILTER_H
@@ -1,5 +1,72 @@
 #include "settingscache.h"
+#include "settingsjournal.h"
+#include "nativesettingsbackend.h"
+#include "settingssharedsegment.h"
+#include "settingsmetrics.h"
+#include "settingsstringpool.h"
 #include <QSettings>
+#include <QSet>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDebug>
+#include <QtConcurrent>
+#include <algorithm>
+#include <optional>
+
+namespace {
+const char* Organization = "TestLabs";
+const char* Application = "TestSettings";
+// Journal size at which it is folded back into the main store
+const qint64 JournalCompactThreshold = 256 * 1024;
+// Editors often save in several steps; wait for them to settle
+const int ExternalReloadDelayMs = 300;
+// Values per task when validating an import in parallel
+const int ValidationChunkSize = 512;
+
+// New groups and keys reuse the item tree's strings where the schema has them;
+// existing entries keep the stored string
+QMap<QString, QVariant>& storedGroup(SettingsCache::Snapshot& values, const QString& group) {
+    auto it = values.find(group);
+    if (it == values.end()) {
+        it = values.insert(SettingsStringPool::shared(group), QMap<QString, QVariant>());
+    }
+    return *it;
+}
+
+void storeValue(QMap<QString, QVariant>& group, const QString& key, const QVariant& value) {
+    auto it = group.find(key);
+    if (it == group.end()) {
+        group.insert(SettingsStringPool::shared(key), value);
+    } else {
+        *it = value;
+    }
+}
+}
+
+// Locks the stripes in `mask` in index order and releases them in reverse
+template <typename Locker>
+class SettingsCache::StripesLocker
+{
+public:
+    static constexpr quint32 AllStripes = (quint32(1) << StripeCount) - 1;
+    static_assert(StripeCount <= 31, "stripe masks are 32 bits wide");
+
+    StripesLocker(const SettingsCache* cache, const char* site, quint32 mask = AllStripes) {
+        for (int i = 0; i < StripeCount; ++i) {
+            if (mask & (quint32(1) << i)) lockers[i].emplace(&cache->stripes[i].lock, site);
+        }
+    }
+    ~StripesLocker() {
+        for (int i = StripeCount - 1; i >= 0; --i) lockers[i].reset();
+    }
+
+private:
+    Q_DISABLE_COPY(StripesLocker)
+
+    std::optional<Locker> lockers[StripeCount];
+};
 
 SettingsCache& SettingsCache::instance() {
     static SettingsCache instance;
@@ -8,83 +75,841 @@ SettingsCache& SettingsCache::instance() {
 
 SettingsCache::SettingsCache(QObject* parent)
     : QObject(parent)
+    , backend(new NativeSettingsBackend(Organization, Application))
+    , journal(new SettingsJournal(backend->journalFileName()))
 {
 }
 
-void SettingsCache::setValue(const QString& group, const QString& key, const QVariant& value) {
-    QWriteLocker locker(&lock);
-    cache[group][key] = value;
+SettingsCache::~SettingsCache() {
+    qDeleteAll(slotLayouts);
 }
 
-QVariant SettingsCache::getValue(const QString& group, const QString& key, const QVariant& defaultValue) const {
-    QReadLocker locker(&lock);
-    auto groupIt = cache.find(group);
-    if (groupIt != cache.end()) {
-        auto keyIt = groupIt->find(key);
-        if (keyIt != groupIt->end()) {
-            return *keyIt;
+int SettingsCache::stripeIndex(const QString& group) {
+    return int(qHash(group) % StripeCount);
+}
+
+bool SettingsCache::isLayer(Scope scope) {
+    Q_ASSERT_X(scope >= DefaultScope && scope < ScopeCount, "SettingsCache", "scope is not a layer");
+    return scope >= DefaultScope && scope < ScopeCount;
+}
+
+quint32 SettingsCache::stripeMask(const QList<Change>& changes) {
+    quint32 mask = 0;
+    for (const Change& change : changes) {
+        mask |= quint32(1) << stripeIndex(change.group);
+    }
+    return mask;
+}
+
+QList<SettingsCache::Snapshot> SettingsCache::splitByStripe(const Snapshot& values) {
+    QList<Snapshot> parts(StripeCount);
+    for (auto groupIt = values.begin(); groupIt != values.end(); ++groupIt) {
+        parts[stripeIndex(groupIt.key())].insert(groupIt.key(), *groupIt);
+    }
+    return parts;
+}
+
+void SettingsCache::setBackend(SettingsBackend* newBackend) {
+    QMutexLocker storeLocker(&storeMutex);
+    backend.reset(newBackend);
+    journal.reset(new SettingsJournal(backend->journalFileName()));
+    storedValues = Snapshot();
+}
+
+bool SettingsCache::setValue(const QString& group, const QString& key, const QVariant& value, Scope scope) {
+    SettingsMetrics::ScopedTimer timer(SettingsMetrics::SetTime);
+    SettingsMetrics::add(SettingsMetrics::Sets);
+    if (!isLayer(scope)) return false;
+    Stripe& stripe = stripes[stripeIndex(group)];
+    SettingsWriteLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+    QString message;
+    if (scope != DefaultScope && !validatorLocked(stripe, group, key).validate(value, &message)) {
+        qWarning() << "Rejected" << group + '/' + key << "=" << value << ":" << message;
+        return false;
+    }
+    storeValue(storedGroup(stripe.layers[scope], group), key, value);
+    updateEffective(stripe, group, key, value, scope);
+    return true;
+}
+
+void SettingsCache::setValidator(const QString& group, const QString& key, const SettingsValidator& validator) {
+    Stripe& stripe = stripes[stripeIndex(group)];
+    SettingsWriteLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+    if (validator.isNull()) {
+        auto groupIt = stripe.validators.find(group);
+        if (groupIt == stripe.validators.end()) return;
+        groupIt->remove(key);
+        if (groupIt->isEmpty()) stripe.validators.erase(groupIt);
+    } else {
+        stripe.validators[group].insert(key, validator);
+    }
+}
+
+bool SettingsCache::validate(const QString& group, const QString& key, const QVariant& value, QString* message) const {
+    SettingsValidator validator;
+    {
+        const Stripe& stripe = stripes[stripeIndex(group)];
+        SettingsReadLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+        validator = validatorLocked(stripe, group, key);
+    }
+    return validator.validate(value, message);
+}
+
+SettingsValidator SettingsCache::validatorLocked(const Stripe& stripe, const QString& group, const QString& key) {
+    auto groupIt = stripe.validators.constFind(group);
+    if (groupIt == stripe.validators.constEnd()) return SettingsValidator();
+    return groupIt->value(key);
+}
+
+QStringList SettingsCache::validateValues(const Snapshot& values) const {
+    QHash<QString, QHash<QString, SettingsValidator>> rules;
+    for (const Stripe& stripe : stripes) {
+        SettingsReadLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+        rules.insert(stripe.validators);
+    }
+    if (rules.isEmpty()) return QStringList();
+
+    struct Entry {
+        const QString* group;
+        const QString* key;
+        const QVariant* value;
+        SettingsValidator validator;
+    };
+    QList<Entry> entries;
+    for (auto groupIt = values.begin(); groupIt != values.end(); ++groupIt) {
+        const QHash<QString, SettingsValidator> groupRules = rules.value(groupIt.key());
+        if (groupRules.isEmpty()) continue;
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            const SettingsValidator validator = groupRules.value(keyIt.key());
+            if (!validator.isNull()) {
+                entries.append({&groupIt.key(), &keyIt.key(), &keyIt.value(), validator});
+            }
+        }
+    }
+
+    // Small imports are not worth handing to the thread pool
+    if (entries.size() <= ValidationChunkSize) {
+        QStringList errors;
+        for (const Entry& entry : std::as_const(entries)) {
+            QString message;
+            if (!entry.validator.validate(*entry.value, &message)) {
+                errors.append(QString("%1/%2: %3").arg(*entry.group, *entry.key, message));
+            }
+        }
+        return errors;
+    }
+
+    QList<QPair<qsizetype, qsizetype>> chunks;
+    for (qsizetype start = 0; start < entries.size(); start += ValidationChunkSize) {
+        chunks.append({start, qMin(entries.size(), start + ValidationChunkSize)});
+    }
+    return QtConcurrent::blockingMappedReduced<QStringList>(
+        chunks,
+        [&entries](const QPair<qsizetype, qsizetype>& chunk) {
+            QStringList errors;
+            for (qsizetype i = chunk.first; i < chunk.second; ++i) {
+                const Entry& entry = entries[i];
+                QString message;
+                if (!entry.validator.validate(*entry.value, &message)) {
+                    errors.append(QString("%1/%2: %3").arg(*entry.group, *entry.key, message));
+                }
+            }
+            return errors;
+        },
+        [](QStringList& result, const QStringList& errors) { result += errors; },
+        QtConcurrent::OrderedReduce);
+}
+
+QStringList SettingsCache::importValues(const Snapshot& values, Scope scope) {
+    if (!isLayer(scope)) return {QString("invalid scope %1").arg(int(scope))};
+    const QStringList errors = validateValues(values);
+    if (!errors.isEmpty()) return errors;
+
+    quint32 mask = 0;
+    for (auto groupIt = values.begin(); groupIt != values.end(); ++groupIt) {
+        mask |= quint32(1) << stripeIndex(groupIt.key());
+    }
+
+    StripesLocker<SettingsWriteLocker> locker(this, SETTINGS_LOCK_SITE, mask);
+    for (auto groupIt = values.begin(); groupIt != values.end(); ++groupIt) {
+        Stripe& stripe = stripes[stripeIndex(groupIt.key())];
+        QMap<QString, QVariant>& group = storedGroup(stripe.layers[scope], groupIt.key());
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            storeValue(group, keyIt.key(), keyIt.value());
+            updateEffective(stripe, groupIt.key(), keyIt.key(), keyIt.value(), scope);
         }
     }
-    return defaultValue;
+    return errors;
+}
+
+QVariant SettingsCache::getValue(const QString& group, const QString& key, const QVariant& defaultValue) const {
+    SettingsMetrics::ScopedTimer timer(SettingsMetrics::GetTime);
+    SettingsMetrics::add(SettingsMetrics::Gets);
+    const Stripe& stripe = stripes[stripeIndex(group)];
+    SettingsReadLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+    const EffectiveValue* value = findEffective(stripe, group, key);
+    return value ? value->value : defaultValue;
+}
+
+SettingsCache::Scope SettingsCache::sourceScope(const QString& group, const QString& key) const {
+    const Stripe& stripe = stripes[stripeIndex(group)];
+    SettingsReadLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+    const EffectiveValue* value = findEffective(stripe, group, key);
+    return value ? value->scope : NoScope;
 }
 
 bool SettingsCache::contains(const QString& group, const QString& key) const {
-    QReadLocker locker(&lock);
-    auto groupIt = cache.find(group);
-    if (groupIt != cache.end()) {
-        return groupIt->contains(key);
+    SettingsMetrics::ScopedTimer timer(SettingsMetrics::GetTime);
+    SettingsMetrics::add(SettingsMetrics::Gets);
+    const Stripe& stripe = stripes[stripeIndex(group)];
+    SettingsReadLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+    return findEffective(stripe, group, key) != nullptr;
+}
+
+const SettingsCache::EffectiveValue* SettingsCache::findEffective(const Stripe& stripe, const QString& group, const QString& key) {
+    auto groupIt = stripe.effective.constFind(group);
+    if (groupIt == stripe.effective.constEnd()) return nullptr;
+
+    auto keyIt = groupIt->constFind(key);
+    return keyIt != groupIt->constEnd() ? &*keyIt : nullptr;
+}
+
+SettingsCache::EffectiveGroup& SettingsCache::effectiveGroup(Stripe& stripe, const QString& group) {
+    auto it = stripe.effective.find(group);
+    if (it == stripe.effective.end()) {
+        it = stripe.effective.insert(SettingsStringPool::shared(group), EffectiveGroup());
     }
-    return false;
+    return *it;
 }
 
-void SettingsCache::remove(const QString& group, const QString& key) {
-    QWriteLocker locker(&lock);
-    auto groupIt = cache.find(group);
-    if (groupIt != cache.end()) {
-        groupIt->remove(key);
+void SettingsCache::setSlots(const QList<QPair<QString, QString>>& keys) {
+    auto* layout = new SlotLayout;
+    layout->keys.reserve(keys.size());
+    int positions[StripeCount] = {};
+    for (const auto& key : keys) {
+        const int stripe = stripeIndex(key.first);
+        layout->index[key.first].insert(key.second, layout->keys.size());
+        layout->keys.append({key.first, key.second, stripe, positions[stripe]++});
+    }
+
+    StripesLocker<SettingsWriteLocker> locker(this, SETTINGS_LOCK_SITE);
+    for (int i = 0; i < StripeCount; ++i) {
+        stripes[i].slotValues = QList<QVariant>(positions[i]);
+    }
+    for (const Slot& slot : std::as_const(layout->keys)) {
+        Stripe& stripe = stripes[slot.stripe];
+        auto groupIt = stripe.effective.constFind(slot.group);
+        if (groupIt == stripe.effective.constEnd()) continue;
+        auto keyIt = groupIt->constFind(slot.key);
+        if (keyIt != groupIt->constEnd()) {
+            stripe.slotValues[slot.position] = keyIt->value;
+        }
+    }
+    slotLayouts.append(layout);
+    slotLayout.storeRelease(layout);
+}
+
+QVariant SettingsCache::slotValue(int slot, const QVariant& defaultValue) const {
+    SettingsMetrics::ScopedTimer timer(SettingsMetrics::GetTime);
+    SettingsMetrics::add(SettingsMetrics::Gets);
+    for (;;) {
+        const SlotLayout* layout = slotLayout.loadAcquire();
+        if (!layout || slot < 0 || slot >= layout->keys.size()) return defaultValue;
+        const Slot& key = layout->keys[slot];
+        const Stripe& stripe = stripes[key.stripe];
+        SettingsReadLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+        // setSlots() replaces the layout while holding every stripe; retry if it just did
+        if (slotLayout.loadRelaxed() != layout) continue;
+        const QVariant& value = stripe.slotValues[key.position];
+        return value.isValid() ? value : defaultValue;
+    }
+}
+
+bool SettingsCache::setSlotValue(int slot, const QVariant& value, Scope scope) {
+    const SlotLayout* layout = slotLayout.loadAcquire();
+    if (!layout || slot < 0 || slot >= layout->keys.size()) return false;
+    return setValue(layout->keys[slot].group, layout->keys[slot].key, value, scope);
+}
+
+void SettingsCache::remove(const QString& group, const QString& key, Scope scope) {
+    if (!isLayer(scope)) return;
+    Stripe& stripe = stripes[stripeIndex(group)];
+    SettingsWriteLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+    Snapshot& values = stripe.layers[scope];
+    auto groupIt = values.find(group);
+    if (groupIt != values.end()) {
+        if (groupIt->remove(key) == 0) return;
         if (groupIt->isEmpty()) {
-            cache.erase(groupIt);
+            values.erase(groupIt);
         }
+        recomputeEffective(stripe, group, key);
     }
 }
 
-void SettingsCache::clear() {
-    QWriteLocker locker(&lock);
-    cache.clear();
+void SettingsCache::clear(Scope scope) {
+    if (!isLayer(scope)) return;
+    StripesLocker<SettingsWriteLocker> locker(this, SETTINGS_LOCK_SITE);
+    for (Stripe& stripe : stripes) {
+        replaceLayer(stripe, scope, Snapshot());
+    }
 }
 
-void SettingsCache::clearGroup(const QString& group) {
-    QWriteLocker locker(&lock);
-    cache.remove(group);
+void SettingsCache::clearGroup(const QString& group, Scope scope) {
+    if (!isLayer(scope)) return;
+    Stripe& stripe = stripes[stripeIndex(group)];
+    SettingsWriteLocker locker(&stripe.lock, SETTINGS_LOCK_SITE);
+    const QMap<QString, QVariant> removed = stripe.layers[scope].take(group);
+    for (auto keyIt = removed.begin(); keyIt != removed.end(); ++keyIt) {
+        recomputeEffective(stripe, group, keyIt.key());
+    }
 }
 
 void SettingsCache::loadFromSettings() {
-    QWriteLocker locker(&lock);
-    cache.clear();
+    QMutexLocker storeLocker(&storeMutex);
+
+    Snapshot site;
+    {
+        QSettings settings(QSettings::SystemScope, Organization, Application);
+        const QStringList groups = settings.childGroups();
+        for (const QString& group : groups) {
+            settings.beginGroup(group);
+            const QStringList keys = settings.childKeys();
+            for (const QString& key : keys) {
+                storeValue(storedGroup(site, group), key, settings.value(key));
+            }
+            settings.endGroup();
+        }
+    }
+
+    storedValues = backend->load();
+    Snapshot user = storedValues;
+    journal->replay(user);
+    persistedValues = user;
+    if (watcher) {
+        updateWatchedPaths();
+        knownSignature = storeSignature();
+    }
+
+    const QList<Snapshot> siteParts = splitByStripe(site);
+    const QList<Snapshot> userParts = splitByStripe(user);
+    {
+        StripesLocker<SettingsWriteLocker> locker(this, SETTINGS_LOCK_SITE);
+        for (int i = 0; i < StripeCount; ++i) {
+            stripes[i].layers[SiteScope] = siteParts[i];
+            stripes[i].layers[UserScope] = userParts[i];
+            rebuildEffective(stripes[i]);
+        }
+    }
+    publishLocked();
+}
+
+bool SettingsCache::saveToSettings() {
+    QList<Change> changes;
+    bool stored = false;
+    {
+        QMutexLocker storeLocker(&storeMutex);
+        SettingsMetrics::ScopedTimer timer(SettingsMetrics::SaveTime);
+        SettingsMetrics::add(SettingsMetrics::Saves);
+        // The cache locks are only held to copy the user scope; diffing and disk
+        // I/O happen under storeMutex alone, which readers and setValue() never take
+        const Snapshot values = snapshot();
+        changes = diff(persistedValues, values);
+        stored = compactLocked(values);
+        // Without the store write the changes only count if the journal took them
+        if (persistedValues != values) changes.clear();
+    }
+    if (!changes.isEmpty()) {
+        emit changesCommitted(changes);
+    }
+    return stored;
+}
+
+bool SettingsCache::compactLocked(const Snapshot& values) {
+    // Held until the journal is emptied, so no other process can commit to it
+    // in between and have its entries dropped by the reset
+    SettingsJournal::Locker journalLocker(journal.data());
+    if (!journalLocker.isLocked()) return false;
+
+    // Edits not yet in the journal go there first. Replaying the journal over
+    // the new store then yields the same values, so a crash between writing the
+    // store and emptying the journal cannot bring back older values.
+    const QList<Change> local = diff(persistedValues, values);
+    const bool journaled = journal->append(local);
+    if (journaled) {
+        persistedValues = values;
+    }
+
+    // The store plus the journal, as every process committed them. Our own
+    // view may miss other processes' commits; writing it would revert them.
+    const Snapshot onDisk = backend->load();
+    Snapshot merged = onDisk;
+    journal->replay(merged);
+    if (!journaled) {
+        for (const Change& change : local) {
+            if (change.removed) {
+                auto groupIt = merged.find(change.group);
+                if (groupIt == merged.end()) continue;
+                groupIt->remove(change.key);
+                if (groupIt->isEmpty()) merged.erase(groupIt);
+            } else {
+                storeValue(storedGroup(merged, change.group), change.key, change.value);
+            }
+        }
+    }
+
+    // Groups still shared with the stored copy compare in O(1) and are skipped
+    QSet<QString> dirtyGroups;
+    const QList<Change> changes = diff(onDisk, merged);
+    for (const Change& change : changes) {
+        dirtyGroups.insert(change.group);
+    }
+
+    // Only drop the journal once the store is safely written
+    SettingsMetrics::add(SettingsMetrics::StoreSyncs);
+    const bool stored = backend->save(merged, dirtyGroups);
+    if (stored) {
+        storedValues = merged;
+        persistedValues = values;
+        journal->reset();
+    } else {
+        storedValues = onDisk;
+        qWarning() << "Cannot write the settings store";
+    }
+    if (watcher) {
+        updateWatchedPaths();
+        // Other processes' commits picked up here reach this cache through the
+        // next reload, which only runs while the signature is out of date
+        if (merged == values) knownSignature = storeSignature();
+    }
+    publishLocked();
+    return stored;
+}
+
+SettingsCache::Snapshot SettingsCache::snapshot() const {
+    return layer(UserScope);
+}
+
+SettingsCache::Snapshot SettingsCache::layer(Scope scope) const {
+    if (!isLayer(scope)) return Snapshot();
+    QList<Snapshot> parts(StripeCount);
+    {
+        StripesLocker<SettingsReadLocker> locker(this, SETTINGS_LOCK_SITE);
+        for (int i = 0; i < StripeCount; ++i) {
+            parts[i] = stripes[i].layers[scope];
+        }
+    }
+
+    // Merged after unlocking; the group maps stay shared with the cache
+    Snapshot values;
+    for (const Snapshot& part : std::as_const(parts)) {
+        values.insert(part);
+    }
+    return values;
+}
 
-    QSettings settings;
-    QStringList groups = settings.childGroups();
+void SettingsCache::restore(const Snapshot& snapshot) {
+    const QList<Snapshot> parts = splitByStripe(snapshot);
+    StripesLocker<SettingsWriteLocker> locker(this, SETTINGS_LOCK_SITE);
+    for (int i = 0; i < StripeCount; ++i) {
+        replaceLayer(stripes[i], UserScope, parts[i]);
+    }
+}
 
-    for (const QString& group : groups) {
-        settings.beginGroup(group);
-        QStringList keys = settings.childKeys();
-        for (const QString& key : keys) {
-            cache[group][key] = settings.value(key);
+void SettingsCache::replaceLayer(Stripe& stripe, Scope scope, const Snapshot& values) {
+    // Only keys that differ between the old and new layer touch the effective view
+    const QList<Change> changes = diff(stripe.layers[scope], values);
+    stripe.layers[scope] = values;
+    for (const Change& change : changes) {
+        if (change.removed) {
+            recomputeEffective(stripe, change.group, change.key);
+        } else {
+            updateEffective(stripe, change.group, change.key, change.value, scope);
         }
-        settings.endGroup();
     }
 }
 
-void SettingsCache::saveToSettings() {
-    QReadLocker locker(&lock);
-    QSettings settings;
+void SettingsCache::updateEffective(Stripe& stripe, const QString& group, const QString& key, const QVariant& value, Scope scope) {
+    EffectiveGroup& values = effectiveGroup(stripe, group);
+    auto it = values.find(key);
+    if (it == values.end()) {
+        values.insert(SettingsStringPool::shared(key), {value, scope});
+    } else if (it->scope <= scope) {
+        it->value = value;
+        it->scope = scope;
+    } else {
+        return;
+    }
+    updateSlot(stripe, group, key, value);
+}
+
+void SettingsCache::updateSlot(Stripe& stripe, const QString& group, const QString& key, const QVariant& value) {
+    // Stable while any stripe is held
+    const SlotLayout* layout = slotLayout.loadRelaxed();
+    if (!layout) return;
+    auto groupIt = layout->index.constFind(group);
+    if (groupIt == layout->index.constEnd()) return;
+    auto keyIt = groupIt->constFind(key);
+    if (keyIt != groupIt->constEnd()) {
+        stripe.slotValues[layout->keys[*keyIt].position] = value;
+    }
+}
+
+void SettingsCache::recomputeEffective(Stripe& stripe, const QString& group, const QString& key) {
+    for (int scope = ScopeCount - 1; scope >= DefaultScope; --scope) {
+        auto groupIt = stripe.layers[scope].constFind(group);
+        if (groupIt == stripe.layers[scope].constEnd()) continue;
+        auto keyIt = groupIt->constFind(key);
+        if (keyIt != groupIt->constEnd()) {
+            EffectiveGroup& values = effectiveGroup(stripe, group);
+            auto valueIt = values.find(key);
+            if (valueIt == values.end()) {
+                values.insert(SettingsStringPool::shared(key), {*keyIt, Scope(scope)});
+            } else {
+                *valueIt = {*keyIt, Scope(scope)};
+            }
+            updateSlot(stripe, group, key, *keyIt);
+            return;
+        }
+    }
+
+    auto groupIt = stripe.effective.find(group);
+    if (groupIt != stripe.effective.end()) {
+        groupIt->remove(key);
+        if (groupIt->isEmpty()) {
+            stripe.effective.erase(groupIt);
+        }
+    }
+    updateSlot(stripe, group, key, QVariant());
+}
+
+void SettingsCache::rebuildEffective(Stripe& stripe) {
+    stripe.effective.clear();
+    for (int scope = DefaultScope; scope < ScopeCount; ++scope) {
+        for (auto groupIt = stripe.layers[scope].cbegin(); groupIt != stripe.layers[scope].cend(); ++groupIt) {
+            QHash<QString, EffectiveValue>& values = stripe.effective[groupIt.key()];
+            for (auto keyIt = groupIt->cbegin(); keyIt != groupIt->cend(); ++keyIt) {
+                values.insert(keyIt.key(), {*keyIt, Scope(scope)});
+            }
+        }
+    }
+
+    const SlotLayout* layout = slotLayout.loadRelaxed();
+    if (!layout) return;
+    for (const Slot& slot : layout->keys) {
+        if (&stripes[slot.stripe] != &stripe) continue;
+        auto groupIt = stripe.effective.constFind(slot.group);
+        stripe.slotValues[slot.position] = groupIt != stripe.effective.constEnd() ? groupIt->value(slot.key).value : QVariant();
+    }
+}
+
+QList<SettingsCache::Change> SettingsCache::diff(const Snapshot& from, const Snapshot& to) {
+    QList<Change> changes;
+
+    for (auto groupIt = to.begin(); groupIt != to.end(); ++groupIt) {
+        const QMap<QString, QVariant> fromGroup = from.value(groupIt.key());
+        // Groups still shared with the base compare in O(1)
+        if (fromGroup == *groupIt) continue;
 
-    for (auto groupIt = cache.begin(); groupIt != cache.end(); ++groupIt) {
-        settings.beginGroup(groupIt.key());
         for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
-            settings.setValue(keyIt.key(), keyIt.value());
+            auto fromIt = fromGroup.find(keyIt.key());
+            if (fromIt == fromGroup.end() || *fromIt != *keyIt) {
+                changes.append({groupIt.key(), keyIt.key(), *keyIt, false});
+            }
+        }
+        for (auto fromIt = fromGroup.begin(); fromIt != fromGroup.end(); ++fromIt) {
+            if (!groupIt->contains(fromIt.key())) {
+                changes.append({groupIt.key(), fromIt.key(), QVariant(), true});
+            }
         }
-        settings.endGroup();
     }
-    settings.sync();
-}
\ No newline at end of file
+
+    for (auto groupIt = from.begin(); groupIt != from.end(); ++groupIt) {
+        if (to.contains(groupIt.key())) continue;
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            changes.append({groupIt.key(), keyIt.key(), QVariant(), true});
+        }
+    }
+
+    return changes;
+}
+
+SettingsCache::Snapshot SettingsCache::effectiveValues() const {
+    // Copying the hashes is O(1); they are flattened after the locks are released
+    QList<QHash<QString, EffectiveGroup>> parts(StripeCount);
+    {
+        StripesLocker<SettingsReadLocker> locker(this, SETTINGS_LOCK_SITE);
+        for (int i = 0; i < StripeCount; ++i) {
+            parts[i] = stripes[i].effective;
+        }
+    }
+
+    Snapshot values;
+    for (const auto& current : std::as_const(parts)) {
+        for (auto groupIt = current.cbegin(); groupIt != current.cend(); ++groupIt) {
+            QMap<QString, QVariant>& group = values[groupIt.key()];
+            for (auto keyIt = groupIt->cbegin(); keyIt != groupIt->cend(); ++keyIt) {
+                group.insert(keyIt.key(), keyIt->value);
+            }
+        }
+    }
+    return values;
+}
+
+bool SettingsCache::saveChanges(const Snapshot& base) {
+    const Snapshot values = snapshot();
+    const QList<Change> changes = diff(base, values);
+    if (changes.isEmpty()) return true;
+
+    {
+        QMutexLocker storeLocker(&storeMutex);
+        if (!commitLocked(changes, values)) return false;
+    }
+    emit changesCommitted(changes);
+    return true;
+}
+
+bool SettingsCache::commitChanges(const QList<Change>& changes, QStringList* errors) {
+    if (changes.isEmpty()) return true;
+
+    Snapshot values;
+    for (const Change& change : changes) {
+        if (!change.removed) values[change.group].insert(change.key, change.value);
+    }
+    const QStringList rejected = validateValues(values);
+    if (!rejected.isEmpty()) {
+        qWarning() << "Rejected" << rejected.size() << "values:" << rejected.first();
+        if (errors) *errors = rejected;
+        return false;
+    }
+
+    {
+        QMutexLocker storeLocker(&storeMutex);
+        {
+            StripesLocker<SettingsWriteLocker> locker(this, SETTINGS_LOCK_SITE, stripeMask(changes));
+            for (const Change& change : changes) {
+                applyChange(UserScope, change);
+            }
+        }
+
+        // Only these changes are persisted, not whatever else is pending in the user scope
+        Snapshot values = persistedValues;
+        for (const Change& change : changes) {
+            if (change.removed) {
+                auto groupIt = values.find(change.group);
+                if (groupIt == values.end()) continue;
+                groupIt->remove(change.key);
+                if (groupIt->isEmpty()) {
+                    values.erase(groupIt);
+                }
+            } else {
+                storeValue(storedGroup(values, change.group), change.key, change.value);
+            }
+        }
+        if (!commitLocked(changes, values)) {
+            if (errors) *errors = QStringList{QStringLiteral("cannot write the settings store")};
+            return false;
+        }
+    }
+
+    emit externalChanges(changes);
+    emit changesCommitted(changes);
+    return true;
+}
+
+bool SettingsCache::commitLocked(const QList<Change>& changes, const Snapshot& values) {
+    SettingsMetrics::ScopedTimer timer(SettingsMetrics::SaveTime);
+    SettingsMetrics::add(SettingsMetrics::Saves);
+    if (!journal->append(changes)) {
+        // Durable only if the store itself can be written
+        return compactLocked(values);
+    }
+
+    persistedValues = values;
+    if (journal->size() > JournalCompactThreshold) {
+        // Already journaled; a failed compaction is retried on the next commit
+        compactLocked(values);
+        return true;
+    }
+    if (watcher) {
+        knownSignature = storeSignature();
+    }
+    publishLocked();
+    return true;
+}
+
+void SettingsCache::setWatchingEnabled(bool enabled) {
+    QMutexLocker storeLocker(&storeMutex);
+    if (!enabled) {
+        delete watcher;
+        delete reloadTimer;
+        watcher = nullptr;
+        reloadTimer = nullptr;
+        return;
+    }
+    if (watcher) return;
+
+    watcher = new QFileSystemWatcher(this);
+    reloadTimer = new QTimer(this);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(ExternalReloadDelayMs);
+
+    connect(watcher, &QFileSystemWatcher::fileChanged, reloadTimer, qOverload<>(&QTimer::start));
+    connect(watcher, &QFileSystemWatcher::directoryChanged, reloadTimer, qOverload<>(&QTimer::start));
+    connect(reloadTimer, &QTimer::timeout, this, &SettingsCache::reloadChanged);
+
+    updateWatchedPaths();
+    knownSignature = storeSignature();
+}
+
+void SettingsCache::updateWatchedPaths() {
+    // Atomic replacement (QSaveFile) drops files from the watcher, so re-add them;
+    // the directories catch files that did not exist yet
+    QStringList paths;
+    const QStringList files = backend->watchPaths();
+    for (const QString& file : files) {
+        QFileInfo info(file);
+        if (info.exists()) paths.append(info.absoluteFilePath());
+        if (QFileInfo::exists(info.absolutePath())) paths.append(info.absolutePath());
+    }
+    paths.removeDuplicates();
+
+    const QStringList watched = watcher->files() + watcher->directories();
+    QStringList missing;
+    for (const QString& path : std::as_const(paths)) {
+        if (!watched.contains(path)) missing.append(path);
+    }
+    if (!missing.isEmpty()) {
+        watcher->addPaths(missing);
+    }
+}
+
+QString SettingsCache::storeSignature() const {
+    QString signature;
+    const QStringList files = backend->watchPaths();
+    for (const QString& file : files) {
+        QFileInfo info(file);
+        signature += QString("%1:%2:%3;").arg(file).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+    }
+    return signature;
+}
+
+void SettingsCache::reloadChanged() {
+    QList<Change> changes;
+    {
+        QMutexLocker storeLocker(&storeMutex);
+        if (!watcher) return;
+        updateWatchedPaths();
+
+        // Our own commits also touch the files; nothing to do for those
+        const QString signature = storeSignature();
+        if (signature == knownSignature) return;
+        knownSignature = signature;
+
+        const Snapshot stored = backend->load();
+        Snapshot persisted = stored;
+        // The writer may be in the middle of an append; leave its tail alone
+        journal->replay(persisted, false);
+
+        changes = diff(persistedValues, persisted);
+        storedValues = stored;
+        persistedValues = persisted;
+    }
+
+    if (changes.isEmpty()) return;
+    SettingsMetrics::add(SettingsMetrics::ExternalReloads);
+
+    {
+        QMutexLocker storeLocker(&storeMutex);
+        {
+            StripesLocker<SettingsWriteLocker> locker(this, SETTINGS_LOCK_SITE, stripeMask(changes));
+            for (const Change& change : std::as_const(changes)) {
+                applyChange(UserScope, change);
+            }
+        }
+        publishLocked();
+    }
+
+    emit externalChanges(changes);
+    emit changesCommitted(changes);
+}
+
+void SettingsCache::applyChange(Scope scope, const Change& change) {
+    Stripe& stripe = stripes[stripeIndex(change.group)];
+    Snapshot& values = stripe.layers[scope];
+    if (change.removed) {
+        auto groupIt = values.find(change.group);
+        if (groupIt == values.end()) return;
+        groupIt->remove(change.key);
+        if (groupIt->isEmpty()) {
+            values.erase(groupIt);
+        }
+        recomputeEffective(stripe, change.group, change.key);
+    } else {
+        storeValue(storedGroup(values, change.group), change.key, change.value);
+        updateEffective(stripe, change.group, change.key, change.value, scope);
+    }
+}
+
+void SettingsCache::setLockProfiling(bool enabled) {
+    for (Stripe& stripe : stripes) {
+        stripe.lock.setProfiling(enabled);
+    }
+}
+
+QList<SettingsLock::SiteProfile> SettingsCache::lockProfile() const {
+    // A site locking different groups shows up in several stripes
+    QHash<QPair<QByteArray, int>, SettingsLock::SiteProfile> sites;
+    for (const Stripe& stripe : stripes) {
+        const QList<SettingsLock::SiteProfile> profile = stripe.lock.profile();
+        for (const SettingsLock::SiteProfile& entry : profile) {
+            SettingsLock::SiteProfile& total = sites[qMakePair(entry.site, int(entry.mode))];
+            if (total.acquisitions == 0) {
+                total.site = entry.site;
+                total.mode = entry.mode;
+            }
+            total.acquisitions += entry.acquisitions;
+            total.contended += entry.contended;
+            total.waitNs += entry.waitNs;
+            total.maxWaitNs = qMax(total.maxWaitNs, entry.maxWaitNs);
+            total.holdNs += entry.holdNs;
+            total.maxHoldNs = qMax(total.maxHoldNs, entry.maxHoldNs);
+        }
+    }
+
+    QList<SettingsLock::SiteProfile> result = sites.values();
+    std::sort(result.begin(), result.end(), [](const SettingsLock::SiteProfile& a, const SettingsLock::SiteProfile& b) {
+        return a.waitNs > b.waitNs;
+    });
+    return result;
+}
+
+void SettingsCache::resetLockProfile() {
+    for (Stripe& stripe : stripes) {
+        stripe.lock.resetProfile();
+    }
+}
+
+void SettingsCache::setSharedSegment(SettingsSharedSegment* segment) {
+    QMutexLocker storeLocker(&storeMutex);
+    sharedSegment = segment;
+    publishLocked();
+}
+
+void SettingsCache::publishLocked() {
+    if (!sharedSegment) return;
+
+    // Other processes only see what is persisted: uncommitted user edits and the
+    // session scope stay private to this instance
+    Snapshot values = layer(DefaultScope);
+    for (const Snapshot& upper : {layer(SiteScope), persistedValues}) {
+        for (auto groupIt = upper.begin(); groupIt != upper.end(); ++groupIt) {
+            values[groupIt.key()].insert(*groupIt);
+        }
+    }
+
+    if (!sharedSegment->publish(values)) {
+        // Readers would otherwise keep reading the previous, now outdated values
+        qWarning() << "Failed to publish settings to shared memory; marking the segment stale";
+        sharedSegment->invalidate();
+    }
+}
@@ -3,35 +3,212 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QVariant>
-#include <QReadWriteLock>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QList>
+#include <QStringList>
+#include <QAtomicPointer>
+
+#include "settingsvalidator.h"
+#include "settingslock.h"
+
+class SettingsJournal;
+class SettingsBackend;
+class SettingsSharedSegment;
+class QFileSystemWatcher;
+class QTimer;
 
 class SettingsCache : public QObject
 {
     Q_OBJECT
 
 public:
+    // Later scopes override earlier ones
+    enum Scope {
+        NoScope = -1,
+        DefaultScope,
+        SiteScope,
+        UserScope,
+        SessionScope,
+        ScopeCount
+    };
+
+    // Group maps are implicitly shared, so a snapshot copies no values and
+    // unchanged groups stay shared
+    using Snapshot = QMap<QString, QMap<QString, QVariant>>;
+
+    struct Change {
+        QString group;
+        QString key;
+        QVariant value;
+        bool removed = false;
+    };
+
     static SettingsCache& instance();
 
-    void setValue(const QString& group, const QString& key, const QVariant& value);
+    // Reads see the effective value: the one from the highest scope that defines the key.
+    // Values outside the default scope are checked against the key's validator;
+    // rejected values are not stored and setValue() returns false.
+    bool setValue(const QString& group, const QString& key, const QVariant& value, Scope scope = UserScope);
     QVariant getValue(const QString& group, const QString& key, const QVariant& defaultValue = QVariant()) const;
+    Scope sourceScope(const QString& group, const QString& key) const;
     bool contains(const QString& group, const QString& key) const;
-    void remove(const QString& group, const QString& key);
-    void clear();
-    void clearGroup(const QString& group);
 
+    // Keys known at build time get fixed slot numbers (see settingsgen); reading
+    // a slot is an array index instead of two string hash lookups
+    void setSlots(const QList<QPair<QString, QString>>& keys);
+    QVariant slotValue(int slot, const QVariant& defaultValue = QVariant()) const;
+    bool setSlotValue(int slot, const QVariant& value, Scope scope = UserScope);
+    void remove(const QString& group, const QString& key, Scope scope = UserScope);
+    void clear(Scope scope = UserScope);
+    void clearGroup(const QString& group, Scope scope = UserScope);
+
+    void setValidator(const QString& group, const QString& key, const SettingsValidator& validator);
+    bool validate(const QString& group, const QString& key, const QVariant& value, QString* message = nullptr) const;
+    // Validates all of `values` in parallel and only if every value passes writes
+    // them in one go. Returns one message per rejected value.
+    QStringList importValues(const Snapshot& values, Scope scope = UserScope);
+
+    // Snapshots cover the user scope, which is the one that is edited and persisted
+    Snapshot snapshot() const;
+    Snapshot layer(Scope scope) const;
+    void restore(const Snapshot& snapshot);
+    static QList<Change> diff(const Snapshot& from, const Snapshot& to);
+    // All scopes flattened, as getValue() sees them
+    Snapshot effectiveValues() const;
+
+    // Store behind the user scope; defaults to the native TestLabs/TestSettings QSettings.
+    // Takes ownership. Call before loadFromSettings().
+    void setBackend(SettingsBackend* backend);
+
+    // Loads the site (system-wide) and user scopes; default and session scopes are left alone.
+    // Changes committed to the journal since the last compaction are replayed on top.
     void loadFromSettings();
-    void saveToSettings();
+    // Writes the groups that differ from the store and empties the journal (compaction).
+    // Commits other processes made to the journal are folded in, not overwritten.
+    // Returns false if the store could not be written; edits that reached the
+    // journal are still kept.
+    bool saveToSettings();
+    // Appends the difference to `base` to the journal; compacts once it grows large.
+    // Returns false if the changes could be neither journaled nor stored.
+    bool saveChanges(const Snapshot& base);
+    // Applies `changes` to the user scope and commits just those, leaving any other
+    // uncommitted edits alone. Reported through externalChanges() like edits made
+    // to the store by another process.
+    // Nothing is applied if any value is rejected by its validator; the reasons
+    // go to `errors`. Large batches are validated in parallel.
+    bool commitChanges(const QList<Change>& changes, QStringList* errors = nullptr);
+
+    // Watches the backing store and applies edits made by other processes key by key
+    void setWatchingEnabled(bool enabled);
+
+    // Republishes the persisted values (over site and defaults) to `segment` whenever
+    // the persisted state changes (load, commit, external edit). Not owned; pass nullptr to stop.
+    void setSharedSegment(SettingsSharedSegment* segment);
+
+    // Records wait and hold times of the cache locks per call site, summed over stripes
+    void setLockProfiling(bool enabled);
+    QList<SettingsLock::SiteProfile> lockProfile() const;
+    void resetLockProfile();
+
+signals:
+    // User-scope keys changed by another process, already applied to the cache
+    void externalChanges(const QList<SettingsCache::Change>& changes);
+    // Every change that reached the store, whichever process or API committed it
+    void changesCommitted(const QList<SettingsCache::Change>& changes);
 
 private:
+    struct EffectiveValue {
+        QVariant value;
+        Scope scope = NoScope;
+    };
+
+    using EffectiveGroup = QHash<QString, EffectiveValue>;
+
     SettingsCache(QObject* parent = nullptr);
-    ~SettingsCache() = default;
+    ~SettingsCache();
 
     SettingsCache(const SettingsCache&) = delete;
     SettingsCache& operator=(const SettingsCache&) = delete;
 
-    QMap<QString, QMap<QString, QVariant>> cache;
-    mutable QReadWriteLock lock;
+    // Groups are spread over independently locked stripes by the hash of their
+    // name. Single-group operations lock one stripe; operations spanning groups
+    // lock the stripes they need in index order, so they see one consistent
+    // state and cannot deadlock against each other.
+    static constexpr int StripeCount = 16;
+    struct Stripe;
+    template <typename Locker> class StripesLocker;
+
+    static int stripeIndex(const QString& group);
+    static quint32 stripeMask(const QList<Change>& changes);
+    static QList<Snapshot> splitByStripe(const Snapshot& values);
+    // Public entry points take a scope from callers; NoScope and ScopeCount are not layers
+    static bool isLayer(Scope scope);
+
+    void replaceLayer(Stripe& stripe, Scope scope, const Snapshot& values);
+    void updateEffective(Stripe& stripe, const QString& group, const QString& key, const QVariant& value, Scope scope);
+    void recomputeEffective(Stripe& stripe, const QString& group, const QString& key);
+    void rebuildEffective(Stripe& stripe);
+    void updateSlot(Stripe& stripe, const QString& group, const QString& key, const QVariant& value);
+    static const EffectiveValue* findEffective(const Stripe& stripe, const QString& group, const QString& key);
+    static EffectiveGroup& effectiveGroup(Stripe& stripe, const QString& group);
+    static SettingsValidator validatorLocked(const Stripe& stripe, const QString& group, const QString& key);
+    QStringList validateValues(const Snapshot& values) const;
+    bool compactLocked(const Snapshot& values);
+    bool commitLocked(const QList<Change>& changes, const Snapshot& values);
+    // The caller holds the stripe of `change.group` for writing
+    void applyChange(Scope scope, const Change& change);
+    void reloadChanged();
+    void updateWatchedPaths();
+    QString storeSignature() const;
+    void publishLocked();
+
+    struct Slot {
+        QString group;
+        QString key;
+        int stripe = 0;
+        // Index into the stripe's slotValues
+        int position = 0;
+    };
+    // Immutable once published; setSlots() publishes a new one
+    struct SlotLayout {
+        QList<Slot> keys;
+        QHash<QString, QHash<QString, int>> index;
+    };
+
+    struct Stripe {
+        mutable SettingsLock lock;
+        Snapshot layers[ScopeCount];
+        // Flattened view of all layers, kept up to date on every write
+        QHash<QString, EffectiveGroup> effective;
+        QHash<QString, QHash<QString, SettingsValidator>> validators;
+        // Effective value of the slots whose group lives in this stripe
+        QList<QVariant> slotValues;
+    };
+
+    Stripe stripes[StripeCount];
+    QAtomicPointer<const SlotLayout> slotLayout;
+    // Every layout ever published; a reader may still be looking at an old one
+    QList<const SlotLayout*> slotLayouts;
+
+    // Serializes access to the persistent store and its journal
+    QMutex storeMutex;
+    QScopedPointer<SettingsBackend> backend;
+    QScopedPointer<SettingsJournal> journal;
+    // User scope as last read from or written to the backend
+    Snapshot storedValues;
+    // Our user scope as far as it reached the backend or the journal; other
+    // processes' commits only enter it through reloadChanged()
+    Snapshot persistedValues;
+
+    QFileSystemWatcher* watcher = nullptr;
+    QTimer* reloadTimer = nullptr;
+    // Size and modification time of the store files after our own last write
+    QString knownSignature;
+
+    SettingsSharedSegment* sharedSegment = nullptr;
 };
 
-#endif // SETTINGSCACHE_H
\ No newline at end of file
+#endif // SETTINGSCACHE_H
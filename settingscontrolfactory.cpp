@@ -1,14 +1,25 @@
 #include "settingscontrolfactory.h"
 #include "settingsitem.h"
+#include "settingsitemwidget.h"
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QHBoxLayout>
-#include <QtWidgets/QCheckBox>
-#include <QtWidgets/QLineEdit>
-#include <QtWidgets/QSpinBox>
-#include <QtWidgets/QComboBox>
 #include <QMessageBox>
 #include <QDebug>
 
+QVariant SettingsControlFactory::value(const QWidget*) const
+{
+    return QVariant();
+}
+
+void SettingsControlFactory::setValue(QWidget*, const QVariant&) const
+{
+}
+
+QMetaObject::Connection SettingsControlFactory::connectValueChanged(QWidget*, QObject*, std::function<void()>) const
+{
+    return QMetaObject::Connection();
+}
+
 QWidget* SettingsControlFactory::createControlWithReset(SettingsItem* item, QWidget* controlWidget)
 {
     QWidget* wrapper = new QWidget();
@@ -23,7 +34,7 @@ QWidget* SettingsControlFactory::createControlWithReset(SettingsItem* item, QWid
     resetBtn->setFixedSize(20, 20);
     resetBtn->setStyleSheet("QPushButton { border: none; }");
 
-    QObject::connect(resetBtn, &QPushButton::clicked, [wrapper, item]() mutable {
+    QObject::connect(resetBtn, &QPushButton::clicked, [item]() {
         QMessageBox::StandardButton reply = QMessageBox::question(
             nullptr,
             "Reset Setting",
@@ -36,34 +47,8 @@ QWidget* SettingsControlFactory::createControlWithReset(SettingsItem* item, QWid
             return;
         }
 
-        QVariant defaultVal = item->defaultValue();
-
-        if (auto* cb = wrapper->findChild<QCheckBox*>()) {
-            cb->setChecked(defaultVal.toBool());
-            qDebug() << "Checkbox reset completed";
-            return;
-        }
-
-        if (auto* le = wrapper->findChild<QLineEdit*>()) {
-            le->setText(defaultVal.toString());
-            qDebug() << "Line edit reset completed";
-            return;
-        }
-
-        if (auto* sb = wrapper->findChild<QSpinBox*>()) {
-            sb->setValue(defaultVal.toInt());
-            qDebug() << "Spinbox reset completed";
-            return;
-        }
-
-        if (auto* combo = wrapper->findChild<QComboBox*>()) {
-            combo->setCurrentIndex(defaultVal.toInt());
-            qDebug() << "Combobox reset completed";
-            return;
-        }
-
-        qWarning() << "No supported widget found for reset inside wrapper. "
-                   << "Wrapper type:" << wrapper->metaObject()->className();
+        SettingsItemWidget::resetToDefault(item);
+        qDebug() << "Reset completed for" << item->name();
     });
 
     layout->addWidget(resetBtn);
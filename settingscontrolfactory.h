@@ -3,15 +3,22 @@
 
 #include <QtWidgets/QWidget>
 #include <QVariant>
+#include <functional>
 
-class SettingsItem;
+#include "settingsitem.h"
 
 class SettingsControlFactory {
 public:
     virtual ~SettingsControlFactory() = default;
     virtual QWidget* create() const = 0;
 
+    // Value binding for a control previously returned by create() of the same factory
+    virtual QVariant value(const QWidget* control) const;
+    virtual void setValue(QWidget* control, const QVariant& value) const;
+    virtual QMetaObject::Connection connectValueChanged(QWidget* control, QObject* receiver,
+                                                        std::function<void()> slot) const;
+
     static QWidget* createControlWithReset(SettingsItem* item, QWidget* controlWidget);
 };
 
-#endif
\ No newline at end of file
+#endif
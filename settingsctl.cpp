@@ -0,0 +1,544 @@
+#include "boundedsettingscache.h"
+#include "settingscache.h"
+#include "settingssharedsegment.h"
+#include "settingsschemaloader.h"
+#include "settingsprofile.h"
+#include "shardedsettingsbackend.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QStringList>
+#include <cstdio>
+
+// Headless access to the settings store. Every operation of one invocation is
+// applied to SettingsCache and persisted as a single commit; if any operation
+// fails nothing is written.
+//
+//   settingsctl [--scope <scope>] [--store-dir <dir> [--memory-budget <bytes> [--stats]]]
+//               get <group/key>... | set <group/key=value>
+//               delete <group/key> | list [group] | export [file|-]
+//               import [file|-] | batch [file|-] | schema <file>
+//   settingsctl peek <group/key>...
+//
+// A batch file contains one operation per line, e.g. "set main_group/3=500".
+// After "schema", values are checked against the constraints in that schema.
+// Files named *.jsonl/*.json or *.scp are exported and imported as settings
+// profiles (see SettingsProfile); anything else uses group/key=value lines.
+// get, list and export read the effective values (all scopes, as the
+// application sees them) unless --scope names a single one; set, delete and
+// import always edit the user scope. --store-dir works on a sharded store
+// (one INI file per group, see ShardedSettingsBackend) instead of the native one.
+// With --memory-budget only the groups that get, set and delete touch are
+// loaded, through BoundedSettingsCache, for stores too large to load whole.
+// Other operations are not available then, and since groups are written back
+// as they are evicted, a failing operation does not undo earlier ones.
+// --stats then prints the cache's counters to stderr after the run.
+// peek reads from the shared-memory segment published by a running writer
+// instead of loading the store, and cannot be combined with other operations.
+
+namespace {
+
+struct Operation {
+    QString command;
+    QString argument;
+};
+
+// Scope read by get/list/export; NoScope means the effective values
+SettingsCache::Scope readScope = SettingsCache::NoScope;
+
+QTextStream& out() {
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+void usage() {
+    err() << "usage: settingsctl [options] <operation> [argument] [<operation> [argument]...]\n"
+          << "options:\n"
+          << "  --scope <scope>          read effective (default), default, site or user values\n"
+          << "  --store-dir <dir>        use the sharded store in <dir>\n"
+          << "  --memory-budget <bytes>  load only the groups get/set/delete touch (needs --store-dir)\n"
+          << "  --stats                  print cache and key filter counters (with --memory-budget)\n"
+          << "operations:\n"
+          << "  get <group/key>...       print values\n"
+          << "  set <group/key=value>    change a value\n"
+          << "  delete <group/key>       remove a value\n"
+          << "  list [group]             print all values, or those of one group\n"
+          << "  export [file|-]          write all values as group/key=value lines or a profile\n"
+          << "  import [file|-]          read group/key=value lines or a profile\n"
+          << "  batch [file|-]           read one operation per line\n"
+          << "  schema <file>            validate later operations against a schema\n"
+          << "  peek <group/key>...      print values from the shared-memory segment\n";
+    err().flush();
+}
+
+bool parseScope(const QString& name) {
+    static const QStringList names{"default", "site", "user"};
+    if (name == "effective") {
+        readScope = SettingsCache::NoScope;
+        return true;
+    }
+    const int index = names.indexOf(name);
+    if (index < 0) {
+        err() << "unknown scope '" << name << "', expected effective, default, site or user\n";
+        return false;
+    }
+    readScope = static_cast<SettingsCache::Scope>(SettingsCache::DefaultScope + index);
+    return true;
+}
+
+SettingsCache::Snapshot readValues(const SettingsCache& cache) {
+    return readScope == SettingsCache::NoScope ? cache.effectiveValues() : cache.layer(readScope);
+}
+
+bool splitPath(const QString& path, QString* group, QString* key) {
+    int slash = path.indexOf('/');
+    if (slash <= 0 || slash == path.size() - 1) {
+        err() << "invalid key '" << path << "', expected group/key\n";
+        return false;
+    }
+    *group = path.left(slash);
+    *key = path.mid(slash + 1);
+    return true;
+}
+
+bool openInput(const QString& name, QFile* file, bool text = true) {
+    const QIODevice::OpenMode mode = text ? QIODevice::ReadOnly | QIODevice::Text : QIODevice::ReadOnly;
+    if (name.isEmpty() || name == "-") {
+        return file->open(stdin, mode);
+    }
+    file->setFileName(name);
+    if (!file->open(mode)) {
+        err() << "cannot open '" << name << "': " << file->errorString() << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool openOutput(const QString& name, QFile* file, bool text = true) {
+    const QIODevice::OpenMode mode = text ? QIODevice::WriteOnly | QIODevice::Text : QIODevice::WriteOnly;
+    if (name.isEmpty() || name == "-") {
+        out().flush();
+        return file->open(stdout, mode);
+    }
+    file->setFileName(name);
+    if (!file->open(mode | QIODevice::Truncate)) {
+        err() << "cannot open '" << name << "': " << file->errorString() << '\n';
+        return false;
+    }
+    return true;
+}
+
+void writeValues(QTextStream& stream, const SettingsCache::Snapshot& values, const QString& onlyGroup) {
+    for (auto groupIt = values.begin(); groupIt != values.end(); ++groupIt) {
+        if (!onlyGroup.isEmpty() && groupIt.key() != onlyGroup) continue;
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            stream << groupIt.key() << '/' << keyIt.key() << '=' << keyIt->toString() << '\n';
+        }
+    }
+}
+
+bool splitAssignment(const QString& assignment, QString* group, QString* key, QString* value) {
+    int eq = assignment.indexOf('=');
+    if (eq < 0) {
+        err() << "invalid assignment '" << assignment << "', expected group/key=value\n";
+        return false;
+    }
+    if (!splitPath(assignment.left(eq), group, key)) return false;
+    *value = assignment.mid(eq + 1);
+    return true;
+}
+
+bool setFromAssignment(SettingsCache& cache, const QString& assignment) {
+    QString group, key, value;
+    if (!splitAssignment(assignment, &group, &key, &value)) return false;
+
+    QString message;
+    if (!cache.validate(group, key, value, &message)) {
+        err() << "invalid value for '" << group << '/' << key << "': " << message << '\n';
+        return false;
+    }
+    cache.setValue(group, key, value);
+    return true;
+}
+
+bool loadSchema(SettingsCache& cache, const QString& fileName) {
+    SettingsSchemaLoader loader;
+    QScopedPointer<SettingsItem> root(loader.load(fileName));
+    if (!root) {
+        err() << fileName << ": " << loader.errorString() << '\n';
+        return false;
+    }
+
+    const QList<SettingsItem*> items = root->getAllChildren();
+    for (const SettingsItem* item : items) {
+        if (item->constraints().isEmpty()) continue;
+        QString error;
+        const SettingsValidator validator = SettingsValidator::compile(item->constraints(), &error);
+        if (!error.isEmpty()) {
+            err() << fileName << ": constraints of '" << item->id() << "': " << error << '\n';
+            return false;
+        }
+        cache.setValidator(item->groupId(), item->id(), validator);
+    }
+    return true;
+}
+
+bool readOperations(const QString& source, QList<Operation>* operations);
+
+bool execute(SettingsCache& cache, const Operation& op) {
+    QString group, key;
+
+    if (op.command == "get") {
+        if (!splitPath(op.argument, &group, &key)) return false;
+        QVariant value;
+        if (readScope == SettingsCache::NoScope) {
+            if (cache.contains(group, key)) value = cache.getValue(group, key);
+        } else {
+            value = cache.layer(readScope).value(group).value(key);
+        }
+        if (!value.isValid()) {
+            err() << "no such key '" << op.argument << "'\n";
+            return false;
+        }
+        out() << op.argument << '=' << value.toString() << '\n';
+        return true;
+    }
+
+    if (op.command == "set") {
+        return setFromAssignment(cache, op.argument);
+    }
+
+    if (op.command == "delete") {
+        if (!splitPath(op.argument, &group, &key)) return false;
+        cache.remove(group, key);
+        return true;
+    }
+
+    if (op.command == "list") {
+        writeValues(out(), readValues(cache), op.argument);
+        return true;
+    }
+
+    if (op.command == "export") {
+        const SettingsProfile::Format format = SettingsProfile::formatForFileName(op.argument);
+        QFile file;
+        if (!openOutput(op.argument, &file, format == SettingsProfile::UnknownFormat)) return false;
+        if (format != SettingsProfile::UnknownFormat) {
+            QString error;
+            if (!SettingsProfile::write(&file, format, readValues(cache), &error)) {
+                err() << "cannot export: " << error << '\n';
+                return false;
+            }
+            return true;
+        }
+
+        QTextStream stream(&file);
+        writeValues(stream, readValues(cache), QString());
+        stream.flush();
+        return true;
+    }
+
+    if (op.command == "import") {
+        const SettingsProfile::Format format = SettingsProfile::formatForFileName(op.argument);
+        QFile file;
+        if (!openInput(op.argument, &file, format == SettingsProfile::UnknownFormat)) return false;
+
+        SettingsCache::Snapshot values;
+        if (format != SettingsProfile::UnknownFormat) {
+            QList<SettingsCache::Change> changes;
+            QString error;
+            if (!SettingsProfile::read(&file, format, &changes, &error)) {
+                err() << "cannot import: " << error << '\n';
+                return false;
+            }
+            for (const SettingsCache::Change& change : std::as_const(changes)) {
+                values[change.group].insert(change.key, change.value);
+            }
+        } else {
+            QTextStream stream(&file);
+            QString line;
+            while (stream.readLineInto(&line)) {
+                if (line.isEmpty() || line.startsWith('#')) continue;
+                const int eq = line.indexOf('=');
+                QString group, key;
+                if (eq < 0) {
+                    err() << "invalid assignment '" << line << "', expected group/key=value\n";
+                    return false;
+                }
+                if (!splitPath(line.left(eq), &group, &key)) return false;
+                values[group].insert(key, line.mid(eq + 1));
+            }
+        }
+
+        // Validated in parallel as a whole before anything is applied
+        const QStringList errors = cache.importValues(values);
+        for (const QString& error : errors) {
+            err() << "invalid value for " << error << '\n';
+        }
+        return errors.isEmpty();
+    }
+
+    if (op.command == "schema") {
+        return loadSchema(cache, op.argument);
+    }
+
+    if (op.command == "batch") {
+        QList<Operation> operations;
+        if (!readOperations(op.argument, &operations)) return false;
+        for (const Operation& nested : std::as_const(operations)) {
+            if (nested.command == "batch") {
+                err() << "nested batch is not supported\n";
+                return false;
+            }
+            if (!execute(cache, nested)) return false;
+        }
+        return true;
+    }
+
+    err() << "unknown operation '" << op.command << "'\n";
+    return false;
+}
+
+bool readOperations(const QString& source, QList<Operation>* operations) {
+    QFile file;
+    if (!openInput(source, &file)) return false;
+    QTextStream stream(&file);
+    QString line;
+    while (stream.readLineInto(&line)) {
+        line = line.trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        int space = line.indexOf(' ');
+        if (space < 0) {
+            operations->append({line, QString()});
+        } else if (line.left(space) == "get") {
+            const QStringList keys = line.mid(space + 1).split(' ', Qt::SkipEmptyParts);
+            for (const QString& key : keys) {
+                operations->append({"get", key});
+            }
+        } else {
+            operations->append({line.left(space), line.mid(space + 1).trimmed()});
+        }
+    }
+    return true;
+}
+
+bool takesOptionalArgument(const QString& command) {
+    return command == "list" || command == "export" || command == "import" || command == "batch";
+}
+
+bool isCommand(const QString& word) {
+    static const QStringList commands{"get", "set", "delete", "list", "export", "import", "batch", "schema"};
+    return commands.contains(word);
+}
+
+void printStats(const BoundedSettingsCache::Stats& stats) {
+    err() << "groups:        " << stats.residentGroups << " resident, " << stats.residentBytes << " of "
+          << stats.budget << " bytes\n"
+          << "lookups:       " << stats.hits << " hits, " << stats.misses << " misses\n"
+          << "evictions:     " << stats.evictions << ", " << stats.writeBacks << " written back, "
+          << stats.pendingWrites << " pending\n"
+          << "key filters:   " << stats.filters << " filters, " << stats.filterBytes << " bytes, "
+          << stats.filterRejects << " rejects, " << stats.filterFalsePositives << " false positives\n";
+    err().flush();
+}
+
+int runBounded(const QList<Operation>& operations, const QString& storeDir, qint64 budget, bool showStats) {
+    // Checked up front, so a malformed operation stops the run before anything is written
+    for (const Operation& op : operations) {
+        QString group, key, value;
+        if (op.command == "get" || op.command == "delete") {
+            if (!splitPath(op.argument, &group, &key)) return 2;
+        } else if (op.command == "set") {
+            if (!splitAssignment(op.argument, &group, &key, &value)) return 2;
+        } else {
+            err() << "'" << op.command << "' is not available with --memory-budget\n";
+            return 2;
+        }
+    }
+
+    BoundedSettingsCache cache(new ShardedSettingsBackend(storeDir), budget);
+    int result = 0;
+    for (const Operation& op : operations) {
+        QString group, key, value;
+        if (op.command == "set") {
+            splitAssignment(op.argument, &group, &key, &value);
+            cache.setValue(group, key, value);
+            continue;
+        }
+
+        splitPath(op.argument, &group, &key);
+        if (op.command == "delete") {
+            cache.remove(group, key);
+        } else if (cache.contains(group, key)) {
+            out() << op.argument << '=' << cache.value(group, key).toString() << '\n';
+        } else {
+            err() << "no such key '" << op.argument << "'\n";
+            result = 1;
+        }
+    }
+
+    const bool flushed = cache.flush();
+    if (showStats) printStats(cache.stats());
+    if (!flushed) {
+        err() << "cannot write the settings store\n";
+        return 1;
+    }
+    return result;
+}
+
+int peek(int argc, char* argv[]) {
+    if (argc < 3) {
+        err() << "'peek' needs an argument\n";
+        usage();
+        return 2;
+    }
+
+    SettingsSharedSegment segment;
+    if (!segment.attach()) {
+        err() << "no shared settings segment: " << segment.errorString() << '\n';
+        return 1;
+    }
+    if (segment.isStale()) {
+        err() << "shared settings segment is stale: the writer's settings no longer fit\n";
+        return 1;
+    }
+
+    int result = 0;
+    for (int i = 2; i < argc; ++i) {
+        const QString path = QString::fromLocal8Bit(argv[i]);
+        QString group, key;
+        if (!splitPath(path, &group, &key)) return 1;
+
+        const QVariant value = segment.value(group, key);
+        if (!value.isValid()) {
+            err() << "no such key '" << path << "'\n";
+            result = 1;
+            continue;
+        }
+        out() << path << '=' << value.toString() << '\n';
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    if (argc > 1 && qstrcmp(argv[1], "peek") == 0) {
+        return peek(argc, argv);
+    }
+
+    int first = 1;
+    QString storeDir;
+    qint64 memoryBudget = 0;
+    bool showStats = false;
+    while (first < argc && (qstrcmp(argv[first], "--scope") == 0 || qstrcmp(argv[first], "--store-dir") == 0
+                            || qstrcmp(argv[first], "--memory-budget") == 0 || qstrcmp(argv[first], "--stats") == 0)) {
+        if (qstrcmp(argv[first], "--stats") == 0) {
+            showStats = true;
+            ++first;
+            continue;
+        }
+        if (first + 1 >= argc) {
+            err() << "'" << argv[first] << "' needs an argument\n";
+            usage();
+            return 2;
+        }
+        const QString value = QString::fromLocal8Bit(argv[first + 1]);
+        if (qstrcmp(argv[first], "--store-dir") == 0) {
+            storeDir = value;
+        } else if (qstrcmp(argv[first], "--memory-budget") == 0) {
+            bool ok = false;
+            memoryBudget = value.toLongLong(&ok);
+            if (!ok || memoryBudget <= 0) {
+                err() << "invalid memory budget '" << value << "'\n";
+                usage();
+                return 2;
+            }
+        } else if (!parseScope(value)) {
+            usage();
+            return 2;
+        }
+        first += 2;
+    }
+
+    QList<Operation> operations;
+    for (int i = first; i < argc; ++i) {
+        const QString command = QString::fromLocal8Bit(argv[i]);
+        if (command == "get") {
+            // Every following word up to the next operation is a key
+            const int firstKey = i + 1;
+            while (i + 1 < argc && !isCommand(QString::fromLocal8Bit(argv[i + 1]))) {
+                operations.append({command, QString::fromLocal8Bit(argv[++i])});
+            }
+            if (i < firstKey) {
+                err() << "'get' needs an argument\n";
+                usage();
+                return 2;
+            }
+            continue;
+        }
+        if (!isCommand(command)) {
+            err() << "unknown operation '" << command << "'\n";
+            usage();
+            return 2;
+        }
+
+        QString argument;
+        bool hasArgument = i + 1 < argc && !(takesOptionalArgument(command) && isCommand(QString::fromLocal8Bit(argv[i + 1])));
+        if (hasArgument) {
+            argument = QString::fromLocal8Bit(argv[++i]);
+        } else if (!takesOptionalArgument(command)) {
+            err() << "'" << command << "' needs an argument\n";
+            usage();
+            return 2;
+        }
+        operations.append({command, argument});
+    }
+
+    if (operations.isEmpty()) {
+        usage();
+        return 2;
+    }
+
+    if (memoryBudget > 0) {
+        if (storeDir.isEmpty()) {
+            err() << "--memory-budget needs --store-dir\n";
+            return 2;
+        }
+        return runBounded(operations, storeDir, memoryBudget, showStats);
+    }
+
+    if (showStats) {
+        err() << "--stats needs --memory-budget\n";
+        return 2;
+    }
+
+    SettingsCache& cache = SettingsCache::instance();
+    if (!storeDir.isEmpty()) {
+        cache.setBackend(new ShardedSettingsBackend(storeDir));
+    }
+    cache.loadFromSettings();
+    const SettingsCache::Snapshot base = cache.snapshot();
+
+    for (const Operation& op : std::as_const(operations)) {
+        if (!execute(cache, op)) {
+            cache.restore(base);
+            err() << "no changes were written\n";
+            return 1;
+        }
+    }
+
+    if (!cache.saveChanges(base)) {
+        err() << "cannot write the settings store\n";
+        return 1;
+    }
+    return 0;
+}
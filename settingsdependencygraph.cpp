@@ -0,0 +1,180 @@
+#include "settingsdependencygraph.h"
+#include <QStringList>
+#include <queue>
+#include <vector>
+
+namespace {
+bool sameValue(const QVariant& a, const QVariant& b) {
+    // Stored values come back as strings ("true", "300")
+    return a == b || a.toString() == b.toString();
+}
+}
+
+bool SettingsDependencyGraph::build(SettingsItem* root) {
+    nodes.clear();
+    ordered.clear();
+    indexByItem.clear();
+    error.clear();
+
+    QHash<QString, SettingsItem*> items;
+    const QList<SettingsItem*> all = root->getAllChildren();
+    for (SettingsItem* item : all) {
+        items.insert(item->id(), item);
+    }
+
+    for (SettingsItem* item : all) {
+        if (item->enabledWhen().isEmpty() && item->visibleWhen().isEmpty()) continue;
+
+        const int target = nodeFor(item);
+        QList<Condition> enabledWhen;
+        QList<Condition> visibleWhen;
+        if (!compile(item->enabledWhen(), target, items, &enabledWhen)
+            || !compile(item->visibleWhen(), target, items, &visibleWhen)) {
+            nodes.clear();
+            indexByItem.clear();
+            return false;
+        }
+        nodes[target].enabledWhen = enabledWhen;
+        nodes[target].visibleWhen = visibleWhen;
+    }
+
+    // Kahn's algorithm; whatever is left over sits on a cycle
+    QList<int> inputs(nodes.size(), 0);
+    for (const Node& node : std::as_const(nodes)) {
+        for (int dependent : node.dependents) {
+            ++inputs[dependent];
+        }
+    }
+    QList<int> ready;
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (inputs[i] == 0) ready.append(i);
+    }
+    while (!ready.isEmpty()) {
+        const int index = ready.takeLast();
+        nodes[index].order = ordered.size();
+        ordered.append(index);
+        for (int dependent : std::as_const(nodes[index].dependents)) {
+            if (--inputs[dependent] == 0) ready.append(dependent);
+        }
+    }
+
+    if (ordered.size() != nodes.size()) {
+        QStringList cycle;
+        for (int i = 0; i < nodes.size(); ++i) {
+            if (inputs[i] > 0) cycle.append(nodes[i].item->id());
+        }
+        error = QString("settings rules form a cycle through %1").arg(cycle.join(", "));
+        nodes.clear();
+        ordered.clear();
+        indexByItem.clear();
+        return false;
+    }
+    return true;
+}
+
+int SettingsDependencyGraph::nodeFor(SettingsItem* item) {
+    auto it = indexByItem.constFind(item);
+    if (it != indexByItem.constEnd()) return *it;
+
+    Node node;
+    node.item = item;
+    nodes.append(node);
+    indexByItem.insert(item, nodes.size() - 1);
+    return nodes.size() - 1;
+}
+
+bool SettingsDependencyGraph::compile(const QList<SettingsCondition>& conditions, int target,
+                                      const QHash<QString, SettingsItem*>& items, QList<Condition>* compiled) {
+    for (const SettingsCondition& condition : conditions) {
+        SettingsItem* sourceItem = items.value(condition.itemId);
+        if (!sourceItem) {
+            error = QString("'%1' depends on unknown item '%2'").arg(nodes[target].item->id(), condition.itemId);
+            return false;
+        }
+
+        const int source = nodeFor(sourceItem);
+        if (!nodes[source].dependents.contains(target)) {
+            nodes[source].dependents.append(target);
+        }
+        compiled->append({source, condition.op, condition.values});
+    }
+    return true;
+}
+
+bool SettingsDependencyGraph::holds(const QList<Condition>& conditions, const ValueLookup& valueOf) const {
+    for (const Condition& condition : conditions) {
+        const Node& source = nodes[condition.source];
+        if (!source.state.enabled) return false;
+
+        const QVariant value = valueOf(source.item);
+        bool matches = false;
+        for (const QVariant& expected : condition.values) {
+            if (sameValue(value, expected)) {
+                matches = true;
+                break;
+            }
+        }
+        if (matches == (condition.op == SettingsCondition::NotEquals)) return false;
+    }
+    return true;
+}
+
+bool SettingsDependencyGraph::evaluate(int index, const ValueLookup& valueOf) {
+    Node& node = nodes[index];
+    State state;
+    state.enabled = holds(node.enabledWhen, valueOf);
+    state.visible = holds(node.visibleWhen, valueOf);
+
+    const bool changed = state.enabled != node.state.enabled || state.visible != node.state.visible;
+    node.state = state;
+    return changed;
+}
+
+QList<SettingsItem*> SettingsDependencyGraph::evaluateAll(const ValueLookup& valueOf) {
+    QList<SettingsItem*> restricted;
+    for (int index : std::as_const(ordered)) {
+        evaluate(index, valueOf);
+        if (!nodes[index].state.enabled || !nodes[index].state.visible) {
+            restricted.append(nodes[index].item);
+        }
+    }
+    return restricted;
+}
+
+QList<SettingsItem*> SettingsDependencyGraph::propagate(const QList<SettingsItem*>& changed, const ValueLookup& valueOf) {
+    QList<SettingsItem*> result;
+    if (nodes.isEmpty()) return result;
+
+    // Min-heap on topological order, so an item is evaluated once all of its
+    // affected inputs have been
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<>> pending;
+    QList<bool> queued(nodes.size(), false);
+    auto enqueueDependents = [&](int index) {
+        for (int dependent : std::as_const(nodes[index].dependents)) {
+            if (!queued[dependent]) {
+                queued[dependent] = true;
+                pending.push({nodes[dependent].order, dependent});
+            }
+        }
+    };
+
+    for (SettingsItem* item : changed) {
+        auto it = indexByItem.constFind(item);
+        if (it != indexByItem.constEnd()) enqueueDependents(*it);
+    }
+
+    while (!pending.empty()) {
+        const int index = pending.top().second;
+        pending.pop();
+        if (evaluate(index, valueOf)) {
+            result.append(nodes[index].item);
+            enqueueDependents(index);
+        }
+    }
+    return result;
+}
+
+SettingsDependencyGraph::State SettingsDependencyGraph::state(const SettingsItem* item) const {
+    auto it = indexByItem.constFind(item);
+    return it != indexByItem.constEnd() ? nodes[*it].state : State();
+}
@@ -0,0 +1,65 @@
+#ifndef SETTINGSDEPENDENCYGRAPH_H
+#define SETTINGSDEPENDENCYGRAPH_H
+
+#include "settingsitem.h"
+#include <QHash>
+#include <QList>
+#include <functional>
+
+// The enabledWhen/visibleWhen rules of a settings tree, compiled into a DAG
+// from each referenced item to the items whose rules mention it. After an edit
+// only the items downstream of the changed one are re-evaluated, each once and
+// after all of its inputs. A disabled item fails every term that refers to it,
+// so rules cascade along chains.
+class SettingsDependencyGraph
+{
+public:
+    using ValueLookup = std::function<QVariant(const SettingsItem* item)>;
+
+    struct State {
+        bool enabled = true;
+        bool visible = true;
+    };
+
+    // Fails on rules that name unknown items or form a cycle; the graph is
+    // then empty and every item stays enabled and visible
+    bool build(SettingsItem* root);
+    QString errorString() const { return error; }
+
+    // Evaluates every rule; returns the items that are not enabled or not visible
+    QList<SettingsItem*> evaluateAll(const ValueLookup& valueOf);
+    // Returns the items whose state changed because the values of `changed` did
+    QList<SettingsItem*> propagate(const QList<SettingsItem*>& changed, const ValueLookup& valueOf);
+
+    State state(const SettingsItem* item) const;
+
+private:
+    struct Condition {
+        int source;
+        SettingsCondition::Operator op;
+        QVariantList values;
+    };
+
+    struct Node {
+        SettingsItem* item = nullptr;
+        QList<Condition> enabledWhen;
+        QList<Condition> visibleWhen;
+        QList<int> dependents;
+        int order = 0;
+        State state;
+    };
+
+    int nodeFor(SettingsItem* item);
+    bool compile(const QList<SettingsCondition>& conditions, int target, const QHash<QString, SettingsItem*>& items,
+                 QList<Condition>* compiled);
+    bool holds(const QList<Condition>& conditions, const ValueLookup& valueOf) const;
+    bool evaluate(int index, const ValueLookup& valueOf);
+
+    QList<Node> nodes;
+    // Node indices in topological order
+    QList<int> ordered;
+    QHash<const SettingsItem*, int> indexByItem;
+    QString error;
+};
+
+#endif // SETTINGSDEPENDENCYGRAPH_H
@@ -0,0 +1,54 @@
+#include "settingsfactorypool.h"
+#include "checkboxfactory.h"
+#include "colordialogfactory.h"
+#include "comboboxfactory.h"
+#include "filebrowsefactory.h"
+#include "lineeditfactory.h"
+#include "pushbuttonfactory.h"
+#include "spinboxfactory.h"
+#include "settingsoptionmodel.h"
+#include <QCborValue>
+
+SettingsControlFactoryPtr SettingsFactoryPool::factory(const QString& control, const QVariantMap& options) {
+    // QVariantMap is ordered, so equal option sets encode to equal keys
+    const QString key = control + '\n' + QString::fromLatin1(QCborValue::fromVariant(options).toCbor().toBase64());
+    auto it = factories.constFind(key);
+    if (it != factories.constEnd()) {
+        return *it;
+    }
+
+    SettingsControlFactoryPtr created = create(control, options);
+    if (created) {
+        factories.insert(key, created);
+    }
+    return created;
+}
+
+SettingsControlFactoryPtr SettingsFactoryPool::create(const QString& control, const QVariantMap& options) {
+    if (control == "checkbox") {
+        return QSharedPointer<CheckBoxFactory>::create();
+    }
+    if (control == "spinbox") {
+        return QSharedPointer<SpinBoxFactory>::create(options.value("min", 0).toInt(), options.value("max", 99).toInt());
+    }
+    if (control == "combobox") {
+        auto model = QSharedPointer<SettingsOptionModel>::create(options.value("items").toStringList());
+        return QSharedPointer<ComboBoxFactory>::create(model, QString(), options.value("completer").toBool());
+    }
+
+    if (!lineEdit) {
+        lineEdit = QSharedPointer<LineEditFactory>::create();
+    }
+    if (control == "lineedit") {
+        return lineEdit;
+    }
+    if (control == "filebrowse") {
+        return QSharedPointer<FileBrowseFactory>::create(
+            lineEdit, QSharedPointer<PushButtonFactory>::create(options.value("button", "Browse...").toString()));
+    }
+    if (control == "color") {
+        return QSharedPointer<ColorDialogFactory>::create(
+            lineEdit, QSharedPointer<PushButtonFactory>::create(options.value("button", "Choose Color").toString()));
+    }
+    return nullptr;
+}
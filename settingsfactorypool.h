@@ -0,0 +1,29 @@
+#ifndef SETTINGSFACTORYPOOL_H
+#define SETTINGSFACTORYPOOL_H
+
+#include "settingsitem.h"
+#include <QHash>
+#include <QVariantMap>
+
+class LineEditFactory;
+
+// Resolves schema control types to factories. Factories are immutable, so
+// every item with the same control type and options gets the same instance.
+//
+//   checkbox, lineedit                  no options
+//   spinbox                             min, max
+//   combobox                            items (list of strings), completer (bool)
+//   filebrowse, color                   button (text)
+class SettingsFactoryPool
+{
+public:
+    SettingsControlFactoryPtr factory(const QString& control, const QVariantMap& options);
+
+private:
+    SettingsControlFactoryPtr create(const QString& control, const QVariantMap& options);
+
+    QHash<QString, SettingsControlFactoryPtr> factories;
+    QSharedPointer<const LineEditFactory> lineEdit;
+};
+
+#endif // SETTINGSFACTORYPOOL_H
@@ -0,0 +1,267 @@
+#include "settingsschemaloader.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QSet>
+#include <QTextStream>
+#include <cstdio>
+
+// Build-time generator: turns a settings schema into a header of constexpr key
+// descriptors with fixed slot numbers and typed accessors on SettingsCache.
+//
+//   settingsgen <schema.json|schema.cbor> <output.h>
+//
+// Accessor names come from the item names ("Font Size" -> fontSize(),
+// setFontSize()), the value type from the default value. An invalid schema or
+// clashing names fail the build; renamed or removed settings then fail to
+// compile wherever they are still used.
+
+namespace {
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+struct Setting {
+    QString group;
+    QString id;
+    QString keyName;
+    QString accessorName;
+    QString type;
+    QString conversion;
+    QString defaultLiteral;
+};
+
+QString quoted(const QString& text) {
+    QString result = "\"";
+    const QByteArray utf8 = text.toUtf8();
+    for (char ch : utf8) {
+        const uchar byte = uchar(ch);
+        if (ch == '"' || ch == '\\') {
+            result += '\\';
+            result += QChar(ch);
+        } else if (byte < 0x20 || byte >= 0x7f) {
+            // Octal escapes cannot swallow the following character
+            result += QString("\\%1").arg(uint(byte), 3, 8, QChar('0'));
+        } else {
+            result += QChar(ch);
+        }
+    }
+    return result + '"';
+}
+
+QStringList words(const QString& name) {
+    QStringList result;
+    QString current;
+    for (QChar ch : name) {
+        if (ch.isLetterOrNumber() && ch.unicode() < 0x80) {
+            current += ch;
+        } else if (!current.isEmpty()) {
+            result.append(current);
+            current.clear();
+        }
+    }
+    if (!current.isEmpty()) result.append(current);
+    return result;
+}
+
+bool isKeyword(const QString& word) {
+    static const QSet<QString> keywords{
+        "auto", "bool", "break", "case", "char", "class", "const", "continue", "default", "delete",
+        "do", "double", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+        "friend", "goto", "if", "inline", "int", "long", "namespace", "new", "operator", "private",
+        "protected", "public", "register", "return", "short", "signed", "sizeof", "static", "struct",
+        "switch", "template", "this", "throw", "true", "try", "typedef", "union", "unsigned",
+        "using", "virtual", "void", "volatile", "while", "signals", "slots", "emit"};
+    return keywords.contains(word);
+}
+
+// Declared by generate() in the same namespace as the settings
+bool isReserved(const QString& name) {
+    static const QSet<QString> reserved{"Key", "Count", "All", "install"};
+    return reserved.contains(name);
+}
+
+bool describe(const SettingsItem* item, Setting* setting) {
+    QStringList parts = words(item->name());
+    if (parts.isEmpty()) parts = words(item->id());
+    if (parts.isEmpty() || parts.first()[0].isDigit()) parts.prepend("setting");
+
+    QString pascal;
+    for (const QString& part : std::as_const(parts)) {
+        pascal += part[0].toUpper() + part.mid(1);
+    }
+    setting->keyName = pascal;
+    setting->accessorName = pascal[0].toLower() + pascal.mid(1);
+    if (isKeyword(setting->accessorName)) setting->accessorName += '_';
+
+    setting->group = item->groupId();
+    setting->id = item->id();
+
+    const QVariant value = item->defaultValue();
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        setting->type = "bool";
+        setting->conversion = "toBool()";
+        setting->defaultLiteral = value.toBool() ? "true" : "false";
+        break;
+    case QMetaType::Int:
+        setting->type = "int";
+        setting->conversion = "toInt()";
+        setting->defaultLiteral = QString::number(value.toInt());
+        break;
+    case QMetaType::Double:
+        setting->type = "double";
+        setting->conversion = "toDouble()";
+        setting->defaultLiteral = QString::number(value.toDouble(), 'g', 17);
+        if (!setting->defaultLiteral.contains('.') && !setting->defaultLiteral.contains('e')) {
+            setting->defaultLiteral += ".0";
+        }
+        break;
+    default:
+        if (value.isValid() && !value.canConvert<QString>()) {
+            err() << "'" << item->id() << "': default value of type " << value.typeName() << " is not supported\n";
+            return false;
+        }
+        setting->type = "QString";
+        setting->conversion = "toString()";
+        setting->defaultLiteral = QString("QString::fromUtf8(%1)").arg(quoted(value.toString()));
+        break;
+    }
+    return true;
+}
+
+QString generate(const QString& schemaName, const QList<Setting>& settings) {
+    QString code;
+    QTextStream out(&code);
+
+    out << "// Generated by settingsgen from " << schemaName << "; do not edit.\n"
+        << "#ifndef SETTINGSKEYS_H\n"
+        << "#define SETTINGSKEYS_H\n\n"
+        << "#include \"settingscache.h\"\n\n"
+        << "namespace SettingsKeys {\n\n"
+        << "struct Key {\n"
+        << "    const char* group;\n"
+        << "    const char* id;\n"
+        << "    int slot;\n"
+        << "};\n\n";
+
+    for (int i = 0; i < settings.size(); ++i) {
+        const Setting& setting = settings[i];
+        out << "inline constexpr Key " << setting.keyName << "{" << quoted(setting.group) << ", "
+            << quoted(setting.id) << ", " << i << "};\n";
+    }
+
+    out << "\ninline constexpr int Count = " << settings.size() << ";\n"
+        << "inline constexpr Key All[] = {\n";
+    for (const Setting& setting : settings) {
+        out << "    " << setting.keyName << ",\n";
+    }
+    out << "};\n\n"
+        << "// Assigns the slots above; call once before using the accessors\n"
+        << "inline void install(SettingsCache& cache = SettingsCache::instance()) {\n"
+        << "    QList<QPair<QString, QString>> keys;\n"
+        << "    keys.reserve(Count);\n"
+        << "    for (const Key& key : All) {\n"
+        << "        keys.append({QString::fromUtf8(key.group), QString::fromUtf8(key.id)});\n"
+        << "    }\n"
+        << "    cache.setSlots(keys);\n"
+        << "}\n\n"
+        << "// Setters return false if the setting's validator rejects the value\n\n";
+
+    for (const Setting& setting : settings) {
+        const QString setter = "set" + setting.keyName;
+        const QString parameter = setting.type == "QString" ? "const QString& value" : setting.type + " value";
+        out << "inline " << setting.type << " " << setting.accessorName << "() {\n"
+            << "    return SettingsCache::instance().slotValue(" << setting.keyName << ".slot, "
+            << setting.defaultLiteral << ")." << setting.conversion << ";\n"
+            << "}\n"
+            << "inline bool " << setter << "(" << parameter << ") {\n"
+            << "    return SettingsCache::instance().setSlotValue(" << setting.keyName << ".slot, value);\n"
+            << "}\n\n";
+    }
+
+    out << "}\n\n"
+        << "#endif // SETTINGSKEYS_H\n";
+    out.flush();
+    return code;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    if (argc != 3) {
+        err() << "usage: settingsgen <schema.json|schema.cbor> <output.h>\n";
+        return 2;
+    }
+    const QString schemaFile = QString::fromLocal8Bit(argv[1]);
+    const QString outputFile = QString::fromLocal8Bit(argv[2]);
+
+    SettingsSchemaLoader loader;
+    QScopedPointer<SettingsItem> root(loader.load(schemaFile));
+    if (!root) {
+        err() << schemaFile << ": " << loader.errorString() << '\n';
+        return 1;
+    }
+
+    QList<Setting> settings;
+    QSet<QString> keys;
+    QSet<QString> names;
+    bool ok = true;
+    const QList<SettingsItem*> items = root->getAllChildren();
+    for (const SettingsItem* item : items) {
+        if (item->controlType().isEmpty()) continue;
+
+        Setting setting;
+        if (!describe(item, &setting)) {
+            err() << schemaFile << ": cannot generate an accessor for '" << item->id() << "'\n";
+            ok = false;
+            continue;
+        }
+        const QString key = setting.group + '/' + setting.id;
+        if (keys.contains(key)) {
+            err() << schemaFile << ": duplicate setting '" << key << "'\n";
+            ok = false;
+        }
+        for (const QString& name : {setting.keyName, setting.accessorName}) {
+            if (isReserved(name)) {
+                err() << schemaFile << ": '" << item->id() << "' (" << item->name()
+                      << ") would generate " << name << ", which is reserved in SettingsKeys\n";
+                ok = false;
+            }
+        }
+        // The key descriptor, the getter and the setter share one namespace
+        const QStringList generated{setting.keyName, setting.accessorName, "set" + setting.keyName};
+        for (const QString& name : generated) {
+            if (names.contains(name)) {
+                err() << schemaFile << ": '" << item->id() << "' (" << item->name()
+                      << ") clashes with another setting that generates " << name << '\n';
+                ok = false;
+            }
+        }
+        keys.insert(key);
+        for (const QString& name : generated) {
+            names.insert(name);
+        }
+        settings.append(setting);
+    }
+    if (!ok) return 1;
+
+    const QByteArray code = generate(QFileInfo(schemaFile).fileName(), settings).toUtf8();
+
+    // Leave an unchanged header alone so dependents are not rebuilt
+    QFile output(outputFile);
+    if (output.open(QIODevice::ReadOnly) && output.readAll() == code) {
+        return 0;
+    }
+    output.close();
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err() << "cannot write " << outputFile << ": " << output.errorString() << '\n';
+        return 1;
+    }
+    output.write(code);
+    return 0;
+}
@@ -0,0 +1,272 @@
+#include "settingsinireader.h"
+#include "settingsstringpool.h"
+#include <QFile>
+
+namespace {
+bool isSpace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+QByteArrayView trimmed(QByteArrayView text) {
+    qsizetype begin = 0;
+    qsizetype end = text.size();
+    while (begin < end && isSpace(text[begin])) ++begin;
+    while (end > begin && isSpace(text[end - 1])) --end;
+    return text.sliced(begin, end - begin);
+}
+
+int hexValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// Inverse of QSettings' key escaping: %XX and %UXXXX escapes, '\' for '/'
+QString decodeKey(QByteArrayView raw) {
+    bool plain = true;
+    for (char ch : raw) {
+        if (ch == '%' || ch == '\\' || uchar(ch) >= 0x80) {
+            plain = false;
+            break;
+        }
+    }
+    if (plain) return QString::fromLatin1(raw);
+
+    QString key;
+    key.reserve(raw.size());
+    for (qsizetype i = 0; i < raw.size(); ++i) {
+        const char ch = raw[i];
+        if (ch == '\\') {
+            key += '/';
+        } else if (ch == '%' && i + 5 < raw.size() && raw[i + 1] == 'U') {
+            int code = 0;
+            bool valid = true;
+            for (int j = 2; j < 6; ++j) {
+                const int digit = hexValue(raw[i + j]);
+                valid = valid && digit >= 0;
+                code = code * 16 + digit;
+            }
+            if (!valid) return QString();
+            key += QChar(char16_t(code));
+            i += 5;
+        } else if (ch == '%' && i + 2 < raw.size()) {
+            const int high = hexValue(raw[i + 1]);
+            const int low = hexValue(raw[i + 2]);
+            if (high < 0 || low < 0) return QString();
+            key += QChar(char16_t(high * 16 + low));
+            i += 2;
+        } else {
+            key += QChar(uchar(ch));
+        }
+    }
+    return key;
+}
+
+// Inverse of QSettings' value escaping: quoting, C escapes, comma-separated
+// string lists and ';' comments. Returns false for syntax left to QSettings.
+bool decodeValue(QByteArrayView raw, QVariant* value) {
+    raw = trimmed(raw);
+
+    bool plain = true;
+    for (char ch : raw) {
+        if (ch == '"' || ch == '\\' || ch == ',' || ch == ';' || ch == '@') {
+            plain = false;
+            break;
+        }
+    }
+    if (plain) {
+        *value = QString::fromUtf8(raw);
+        return true;
+    }
+
+    QStringList elements;
+    QString current;
+    qsizetype runStart = -1;
+    bool inQuotes = false;
+    bool quoted = false;
+    // Length of `current` up to the last quoted or escaped character; unquoted
+    // whitespace after it is trimmed when the element ends
+    qsizetype keep = 0;
+
+    auto flushRun = [&](qsizetype end) {
+        if (runStart < 0) return;
+        current += QString::fromUtf8(raw.sliced(runStart, end - runStart));
+        runStart = -1;
+    };
+    auto finishElement = [&]() {
+        if (!quoted) {
+            qsizetype end = current.size();
+            while (end > keep && current[end - 1].isSpace()) --end;
+            current.truncate(end);
+        }
+        elements.append(current);
+        current.clear();
+        keep = 0;
+        quoted = false;
+    };
+
+    qsizetype i = 0;
+    for (; i < raw.size(); ++i) {
+        const char ch = raw[i];
+        if (ch == '"') {
+            flushRun(i);
+            inQuotes = !inQuotes;
+            quoted = true;
+            keep = current.size();
+        } else if (ch == '\\' && i + 1 < raw.size()) {
+            flushRun(i);
+            const char escaped = raw[++i];
+            switch (escaped) {
+            case 'a': current += '\a'; break;
+            case 'b': current += '\b'; break;
+            case 'f': current += '\f'; break;
+            case 'n': current += '\n'; break;
+            case 'r': current += '\r'; break;
+            case 't': current += '\t'; break;
+            case 'v': current += '\v'; break;
+            case 'x': {
+                int code = 0;
+                while (i + 1 < raw.size() && hexValue(raw[i + 1]) >= 0) {
+                    code = code * 16 + hexValue(raw[++i]);
+                }
+                current += QChar(char16_t(code));
+                break;
+            }
+            default:
+                if (escaped >= '0' && escaped <= '7') {
+                    int code = escaped - '0';
+                    for (int digits = 1; digits < 3 && i + 1 < raw.size() && raw[i + 1] >= '0' && raw[i + 1] <= '7'; ++digits) {
+                        code = code * 8 + (raw[++i] - '0');
+                    }
+                    current += QChar(char16_t(code));
+                } else {
+                    // \\ \' \" \? and anything unknown stand for themselves
+                    current += QChar(uchar(escaped));
+                }
+                break;
+            }
+            keep = current.size();
+        } else if (!inQuotes && ch == ',') {
+            flushRun(i);
+            finishElement();
+        } else if (!inQuotes && ch == ';') {
+            break;
+        } else if (!inQuotes && isSpace(ch) && runStart < 0 && current.isEmpty() && !quoted) {
+            // Leading whitespace of a list element
+        } else if (runStart < 0) {
+            runStart = i;
+        }
+    }
+    flushRun(i);
+    if (inQuotes) return false;
+    finishElement();
+
+    for (QString& element : elements) {
+        if (element.startsWith('@')) {
+            if (!element.startsWith(QLatin1String("@@"))) return false;
+            element.remove(0, 1);
+        }
+    }
+
+    if (elements.size() == 1) {
+        *value = elements.first();
+    } else {
+        *value = elements;
+    }
+    return true;
+}
+}
+
+bool SettingsIniReader::read(const QString& fileName, SettingsCache::Snapshot* values, const QString& onlyGroup) {
+    QFile file(fileName);
+    if (!file.exists()) return true;
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    const qint64 size = file.size();
+    if (size == 0) return true;
+
+    uchar* mapped = file.map(0, size);
+    if (!mapped) {
+        const QByteArray data = file.readAll();
+        return parse(data, values, onlyGroup);
+    }
+    const bool ok = parse(QByteArrayView(reinterpret_cast<const char*>(mapped), size), values, onlyGroup);
+    file.unmap(mapped);
+    return ok;
+}
+
+bool SettingsIniReader::parse(QByteArrayView text, SettingsCache::Snapshot* values, const QString& onlyGroup) {
+    if (text.startsWith("\xEF\xBB\xBF")) {
+        text = text.sliced(3);
+    }
+
+    QString group;
+    bool active = false;
+    SettingsCache::Snapshot::iterator groupIt = values->end();
+    QByteArray continued;
+
+    qsizetype pos = 0;
+    while (pos < text.size()) {
+        qsizetype end = text.indexOf('\n', pos);
+        if (end < 0) end = text.size();
+        QByteArrayView line = text.sliced(pos, end - pos);
+        pos = end + 1;
+
+        // A backslash at the end of a line continues the value on the next one
+        if (line.endsWith('\r')) line.chop(1);
+        if (line.endsWith('\\') && !line.endsWith("\\\\")) {
+            continued.clear();
+            while (line.endsWith('\\') && !line.endsWith("\\\\")) {
+                line.chop(1);
+                continued += line;
+                if (pos >= text.size()) break;
+                end = text.indexOf('\n', pos);
+                if (end < 0) end = text.size();
+                line = text.sliced(pos, end - pos);
+                pos = end + 1;
+                if (line.endsWith('\r')) line.chop(1);
+            }
+            continued += line;
+            line = continued;
+        }
+
+        line = trimmed(line);
+        if (line.isEmpty() || line.startsWith(';') || line.startsWith('#')) continue;
+
+        if (line.startsWith('[')) {
+            const qsizetype close = line.indexOf(']');
+            if (close < 0) return false;
+            const QByteArrayView section = trimmed(line.sliced(1, close - 1));
+
+            // [General] holds keys outside any group, [%General] the group "General"
+            if (section.compare("general", Qt::CaseInsensitive) == 0) {
+                active = false;
+                continue;
+            }
+            group = SettingsStringPool::shared(section.compare("%general", Qt::CaseInsensitive) == 0 ? QString("General") : decodeKey(section));
+            // Nested sections only hold keys of subgroups
+            active = !group.isEmpty() && !group.contains('/') && (onlyGroup.isEmpty() || group == onlyGroup);
+            groupIt = values->find(group);
+            continue;
+        }
+
+        const qsizetype eq = line.indexOf('=');
+        if (eq < 0) return false;
+        if (!active) continue;
+
+        const QString key = SettingsStringPool::shared(decodeKey(trimmed(line.first(eq))));
+        if (key.isEmpty()) return false;
+        // Keys of subgroups
+        if (key.contains('/')) continue;
+
+        QVariant value;
+        if (!decodeValue(line.sliced(eq + 1), &value)) return false;
+
+        if (groupIt == values->end()) {
+            groupIt = values->insert(group, SettingsCache::Snapshot::mapped_type());
+        }
+        groupIt->insert(key, value);
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef SETTINGSINIREADER_H
+#define SETTINGSINIREADER_H
+
+#include "settingscache.h"
+
+// Reads the INI files QSettings writes on Unix straight into a snapshot,
+// instead of letting QSettings build its own maps and copying every value out
+// through value(). The file is memory-mapped and scanned in place; plain keys
+// and values are decoded directly from the mapped bytes.
+//
+// Only top-level groups and their direct keys are read, like
+// NativeSettingsBackend does. Values come back as QString or QStringList, as
+// QSettings returns them. For syntax it does not handle (@Variant(...),
+// @ByteArray(...), ...) read() returns false and the caller should fall back
+// to QSettings.
+class SettingsIniReader
+{
+public:
+    // A missing file reads as empty. With `onlyGroup` set, other sections are skipped.
+    static bool read(const QString& fileName, SettingsCache::Snapshot* values, const QString& onlyGroup = QString());
+    static bool parse(QByteArrayView text, SettingsCache::Snapshot* values, const QString& onlyGroup = QString());
+};
+
+#endif // SETTINGSINIREADER_H
@@ -1,14 +1,35 @@
 #ifndef SETTINGSITEM_H
 #define SETTINGSITEM_H
 
-#include <QHBoxLayout>
-#include <QComboBox>
-#include <QCheckBox>
-#include <QSpinBox>
-#include <QLineEdit>
-
-#include "settingscontrolfactory.h"
+#include <QString>
+#include <QVariant>
+#include <QList>
+#include <QSharedPointer>
+
+class QWidget;
+class SettingsControlFactory;
+
+// Factories are immutable once constructed, so a single instance can be
+// shared by any number of items; per-widget state lives in the created control.
+using SettingsControlFactoryPtr = QSharedPointer<const SettingsControlFactory>;
+
+// One term of an enable/visibility rule: holds while the item `itemId` is
+// enabled and its value matches. A rule is the conjunction of its terms.
+struct SettingsCondition {
+    enum Operator {
+        Equals,
+        NotEquals,
+        In
+    };
+
+    QString itemId;
+    Operator op = Equals;
+    QVariantList values;
+};
 
+// Ids are interned (SettingsStringPool); the cache and the stores share them.
+// The tree itself only depends on QtCore; it keeps pointers to the bound
+// controls, which SettingsItemWidget (settings_widgets) creates and drives.
 class SettingsItem {
 public:
     SettingsItem(const QString& id,
@@ -16,7 +37,7 @@ public:
                  const QString& description,
                  const QVariant& defaultValue,
                  SettingsItem* parent = nullptr,
-                 SettingsControlFactory* factory = nullptr,
+                 SettingsControlFactoryPtr factory = nullptr,
                  bool enableSaving = true);
 
     SettingsItem(const QString& id,
@@ -28,6 +49,7 @@ public:
 
     SettingsItem* parent() const { return parent_; }
     void appendChild(SettingsItem* child);
+    void reserveChildren(int count) { children_.reserve(count); }
     SettingsItem* child(int row) const;
     int childCount() const { return children_.size(); }
     int row() const;
@@ -36,6 +58,9 @@ public:
         return (parent_ == nullptr || factory_ == nullptr);
     }
 
+    // Id of the top-level group this item belongs to; used as the storage group
+    QString groupId() const;
+
     QList<SettingsItem*> getAllChildren() const;
     SettingsItem* findItemById(const QString& id) const;
     SettingsItem* findItemByName(const QString& name) const;
@@ -45,19 +70,27 @@ public:
     QString id() const { return id_; }
     QString description() const { return description_; }
     QVariant defaultValue() const { return defaultValue_; }
-    SettingsControlFactory* factory() const { return factory_; }
+    const SettingsControlFactory* factory() const { return factory_.data(); }
+    // Schema control type ("spinbox", ...); empty for groups and hand-built items
+    QString controlType() const { return controlType_; }
+    void setControlType(const QString& type);
+
+    // Compiled into a SettingsValidator (see settingsvalidator.h for the keys)
+    QVariantMap constraints() const { return constraints_; }
+    void setConstraints(const QVariantMap& constraints) { constraints_ = constraints; }
+
+    // Evaluated by SettingsDependencyGraph
+    const QList<SettingsCondition>& enabledWhen() const { return enabledWhen_; }
+    void setEnabledWhen(const QList<SettingsCondition>& conditions) { enabledWhen_ = conditions; }
+    const QList<SettingsCondition>& visibleWhen() const { return visibleWhen_; }
+    void setVisibleWhen(const QList<SettingsCondition>& conditions) { visibleWhen_ = conditions; }
 
     bool isSavingEnabled() const { return enableSaving_; }
 
-    void resetToDefault();
-    QHBoxLayout* createWidget();
     QWidget* controlWidget() const { return controlWidget_; }
     void setControlWidget(QWidget* widget) { controlWidget_ = widget; }
-    QVariant getValue() const;
-
-    QComboBox* comboBox() const;
-    QCheckBox* checkBox() const;
-    QSpinBox* spinBox() const;
+    QWidget* control() const { return control_; }
+    void setControl(QWidget* control) { control_ = control; }
 
 private:
     SettingsItem* parent_;
@@ -68,8 +101,14 @@ private:
     QString description_;
     QVariant defaultValue_;
 
-    SettingsControlFactory* factory_;
+    SettingsControlFactoryPtr factory_;
+    QString controlType_;
+    QVariantMap constraints_;
+    QList<SettingsCondition> enabledWhen_;
+    QList<SettingsCondition> visibleWhen_;
+    // Owned by the page the row was added to, not by the item
     QWidget* controlWidget_ = nullptr;
+    QWidget* control_ = nullptr;
     bool enableSaving_;
 };
 
@@ -0,0 +1,69 @@
+#include "settingsitemwidget.h"
+#include "settingsitem.h"
+#include "settingscontrolfactory.h"
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QDebug>
+
+void SettingsItemWidget::resetToDefault(const SettingsItem* item)
+{
+    if (!item->factory() || !item->control()) {
+        qWarning() << "Cannot reset: no factory or control";
+        return;
+    }
+
+    item->factory()->setValue(item->control(), item->defaultValue());
+}
+
+QHBoxLayout* SettingsItemWidget::create(SettingsItem* item)
+{
+    const SettingsControlFactory* factory = item->factory();
+    if (!factory) {
+        qWarning() << "No factory to create widget";
+        return nullptr;
+    }
+
+    QWidget* control = factory->create();
+    if (!control) {
+        qWarning() << "Factory returned nullptr";
+        return nullptr;
+    }
+
+    QHBoxLayout* layout = new QHBoxLayout();
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(8);
+
+    QLabel* label = new QLabel(item->name() + ":");
+    label->setMinimumWidth(150);
+    label->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    layout->addWidget(label);
+
+    // Устанавливаем значение по умолчанию из defaultValue
+    factory->setValue(control, item->defaultValue());
+
+    item->setControl(control);
+    item->setControlWidget(SettingsControlFactory::createControlWithReset(item, control));
+    layout->addWidget(item->controlWidget(), 1);
+
+    return layout;
+}
+
+QVariant SettingsItemWidget::value(const SettingsItem* item)
+{
+    if (!item->factory() || !item->control()) return QVariant();
+    return item->factory()->value(item->control());
+}
+
+void SettingsItemWidget::setValue(const SettingsItem* item, const QVariant& value)
+{
+    if (!item->factory() || !item->control()) return;
+    item->factory()->setValue(item->control(), value);
+}
+
+QMetaObject::Connection SettingsItemWidget::connectValueChanged(const SettingsItem* item,
+                                                                QObject* receiver,
+                                                                std::function<void()> slot)
+{
+    if (!item->factory() || !item->control()) return QMetaObject::Connection();
+    return item->factory()->connectValueChanged(item->control(), receiver, std::move(slot));
+}
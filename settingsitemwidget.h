@@ -0,0 +1,26 @@
+#ifndef SETTINGSITEMWIDGET_H
+#define SETTINGSITEMWIDGET_H
+
+#include <QVariant>
+#include <QObject>
+#include <functional>
+
+class QHBoxLayout;
+class SettingsItem;
+
+// Binds a SettingsItem to the control created by its factory. The item only
+// keeps the control pointers; everything that touches widgets lives here.
+class SettingsItemWidget {
+public:
+    // Label + control row; the control starts at the item's default value
+    static QHBoxLayout* create(SettingsItem* item);
+
+    static QVariant value(const SettingsItem* item);
+    static void setValue(const SettingsItem* item, const QVariant& value);
+    static void resetToDefault(const SettingsItem* item);
+    static QMetaObject::Connection connectValueChanged(const SettingsItem* item,
+                                                       QObject* receiver,
+                                                       std::function<void()> slot);
+};
+
+#endif // SETTINGSITEMWIDGET_H
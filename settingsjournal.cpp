@@ -0,0 +1,196 @@
+#include "settingsjournal.h"
+#include "settingsmetrics.h"
+#include "settingsstringpool.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+const QByteArray Magic("SCJ2");
+// Frame: payload size, payload checksum, payload. One frame per commit; the
+// payload is the number of changes followed by the changes.
+const int FrameHeaderSize = sizeof(quint32) + sizeof(quint16);
+// Commits are small; a holder taking longer than this is likely hung
+const int LockTimeoutMs = 5000;
+
+QByteArray encodeFrame(const QList<SettingsCache::Change>& changes) {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << quint32(changes.size());
+    for (const SettingsCache::Change& change : changes) {
+        stream << quint8(change.removed) << change.group << change.key << change.value;
+    }
+
+    QByteArray frame;
+    QDataStream header(&frame, QIODevice::WriteOnly);
+    header << quint32(payload.size()) << quint16(qChecksum(payload));
+    frame.append(payload);
+    return frame;
+}
+}
+
+SettingsJournal::SettingsJournal(const QString& fileName)
+    : path(fileName)
+    , lockFile(fileName + ".lock")
+{
+}
+
+SettingsJournal::~SettingsJournal() {
+    file.close();
+}
+
+qint64 SettingsJournal::size() const {
+    return file.isOpen() ? file.size() : QFileInfo(path).size();
+}
+
+bool SettingsJournal::lock() {
+    if (lockDepth > 0) {
+        ++lockDepth;
+        return true;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    // QLockFile removes the lock of a process that died holding it
+    if (!lockFile.tryLock(LockTimeoutMs)) {
+        qWarning() << "Cannot lock settings journal" << lockFile.fileName() << "error" << lockFile.error();
+        return false;
+    }
+    lockDepth = 1;
+    return true;
+}
+
+void SettingsJournal::unlock() {
+    if (--lockDepth == 0) lockFile.unlock();
+}
+
+bool SettingsJournal::openForAppend() {
+    if (file.isOpen()) return true;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Append)) {
+        qWarning() << "Cannot open settings journal" << path << file.errorString();
+        return false;
+    }
+    if (file.size() == 0 && file.write(Magic) != Magic.size()) {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+bool SettingsJournal::syncToDisk() {
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool SettingsJournal::append(const QList<SettingsCache::Change>& changes) {
+    if (changes.isEmpty()) return true;
+    Locker locker(this);
+    if (!locker.isLocked()) return false;
+    // Reopen every time: another process may have compacted and replaced the file
+    file.close();
+    if (!openForAppend()) return false;
+
+    // One frame, one write and one fsync per commit, however many keys it
+    // touches; replay applies the frame whole or not at all
+    const QByteArray batch = encodeFrame(changes);
+    if (file.write(batch) != batch.size() || !syncToDisk()) {
+        qWarning() << "Cannot append to settings journal" << path << file.errorString();
+        return false;
+    }
+    SettingsMetrics::add(SettingsMetrics::BytesWritten, quint64(batch.size()));
+    return true;
+}
+
+int SettingsJournal::replay(SettingsCache::Snapshot& values, bool repairTail) {
+    file.close();
+    if (!QFile::exists(path)) return 0;
+    // Without the lock another process may be mid-append; read, but do not repair
+    Locker locker(this);
+    if (!locker.isLocked()) repairTail = false;
+
+    QFile input(path);
+    if (!input.open(QIODevice::ReadOnly)) return 0;
+    const QByteArray data = input.readAll();
+    input.close();
+
+    if (!data.startsWith(Magic)) {
+        if (!data.isEmpty()) {
+            qWarning() << "Ignoring settings journal with unknown format" << path;
+        }
+        return 0;
+    }
+
+    int applied = 0;
+    qsizetype offset = Magic.size();
+    while (data.size() - offset >= FrameHeaderSize) {
+        QDataStream header(data.mid(offset, FrameHeaderSize));
+        quint32 length = 0;
+        quint16 checksum = 0;
+        header >> length >> checksum;
+
+        if (data.size() - offset - FrameHeaderSize < qsizetype(length)) break;
+        const QByteArray payload = data.mid(offset + FrameHeaderSize, length);
+        if (qChecksum(payload) != checksum) break;
+
+        QDataStream stream(payload);
+        stream.setVersion(QDataStream::Qt_6_0);
+        quint32 count = 0;
+        stream >> count;
+        QList<SettingsCache::Change> changes;
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            quint8 removed = 0;
+            SettingsCache::Change change;
+            stream >> removed >> change.group >> change.key >> change.value;
+            change.removed = removed;
+            changes.append(change);
+        }
+        if (stream.status() != QDataStream::Ok) break;
+
+        for (const SettingsCache::Change& change : std::as_const(changes)) {
+            if (change.removed) {
+                auto groupIt = values.find(change.group);
+                if (groupIt != values.end()) {
+                    groupIt->remove(change.key);
+                    if (groupIt->isEmpty()) values.erase(groupIt);
+                }
+            } else {
+                values[SettingsStringPool::shared(change.group)][SettingsStringPool::shared(change.key)] = change.value;
+            }
+        }
+
+        offset += FrameHeaderSize + length;
+        applied += changes.size();
+    }
+
+    if (repairTail && offset < data.size()) {
+        qWarning() << "Discarding torn tail of settings journal" << path << "at offset" << offset;
+        QFile::resize(path, offset);
+    }
+    return applied;
+}
+
+bool SettingsJournal::reset() {
+    file.close();
+    Locker locker(this);
+    if (!locker.isLocked()) return false;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile output(path);
+    if (!output.open(QIODevice::WriteOnly)) return false;
+    output.write(Magic);
+    return output.commit();
+}
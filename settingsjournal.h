@@ -0,0 +1,58 @@
+#ifndef SETTINGSJOURNAL_H
+#define SETTINGSJOURNAL_H
+
+#include "settingscache.h"
+#include <QFile>
+#include <QLockFile>
+
+// Append-only log of committed user-scope changes. Each commit appends one
+// checksummed frame holding all of its changes and is made durable with a
+// single fsync, so its cost follows the size of the change rather than the
+// size of the store, and a crash mid-append loses the whole commit, never half.
+// The log is replayed on load and emptied once it has been compacted into the
+// main store. Appends, replays and resets take a lock file next to the log, so
+// processes sharing the store do not interleave them; a compaction holds it
+// (Locker) from reading the log until it has been emptied.
+class SettingsJournal
+{
+public:
+    // Holds the journal's lock file for its lifetime; nests within one SettingsJournal
+    class Locker
+    {
+    public:
+        explicit Locker(SettingsJournal* journal) : journal(journal), locked(journal->lock()) {}
+        ~Locker() { if (locked) journal->unlock(); }
+        bool isLocked() const { return locked; }
+
+    private:
+        SettingsJournal* journal;
+        bool locked;
+    };
+
+    explicit SettingsJournal(const QString& fileName);
+    ~SettingsJournal();
+
+    QString fileName() const { return path; }
+    qint64 size() const;
+
+    bool append(const QList<SettingsCache::Change>& changes);
+    // Applies all intact commits to `values` and returns the number of changes
+    // applied. A torn tail left by a crash is cut off
+    // unless `repairTail` is false (another process may still be appending).
+    int replay(SettingsCache::Snapshot& values, bool repairTail = true);
+    // Atomically replaces the log with an empty one
+    bool reset();
+
+private:
+    bool lock();
+    void unlock();
+    bool openForAppend();
+    bool syncToDisk();
+
+    QString path;
+    QFile file;
+    QLockFile lockFile;
+    int lockDepth = 0;
+};
+
+#endif // SETTINGSJOURNAL_H
@@ -0,0 +1,251 @@
+#include "settingsprotocol.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QHash>
+#include <algorithm>
+#include <cstdio>
+
+// Load generator for SettingsService. Keeps a fixed number of batched requests
+// in flight on one connection and reports throughput and round-trip latency.
+//
+//   settingsload [--server name] [--requests n] [--batch n] [--pipeline n]
+//                [--writes percent] [--subscribe] [--key group/key]...
+//
+// Writes go to the "loadtest" group of the running instance's store and are
+// removed again when the run ends. To keep the real store untouched entirely,
+// point the instance at a scratch store: My1stProj --serve --store-dir <dir>.
+
+namespace {
+
+const char* const LoadGroup = "loadtest";
+const int LoadKeyCount = 1024;
+
+QTextStream& out() {
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+struct Key {
+    QString group;
+    QString key;
+};
+
+QByteArray buildRequest(quint32 requestId, bool write, const QList<Key>& keys, int batch, int* cursor) {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << requestId << quint8(write ? SettingsProtocol::Set : SettingsProtocol::Get) << quint32(batch);
+    for (int i = 0; i < batch; ++i) {
+        if (write) {
+            stream << QString(LoadGroup) << QString("k%1").arg(*cursor % LoadKeyCount) << QVariant(int(requestId));
+        } else {
+            const Key& key = keys[*cursor % keys.size()];
+            stream << key.group << key.key;
+        }
+        ++*cursor;
+    }
+
+    QByteArray frame;
+    SettingsProtocol::appendFrame(&frame, payload);
+    return frame;
+}
+
+QByteArray buildCleanup(quint32 requestId, int keyCount) {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << requestId << quint8(SettingsProtocol::Remove) << quint32(keyCount);
+    for (int i = 0; i < keyCount; ++i) {
+        stream << QString(LoadGroup) << QString("k%1").arg(i);
+    }
+
+    QByteArray frame;
+    SettingsProtocol::appendFrame(&frame, payload);
+    return frame;
+}
+
+// Removes the keys written during the run; replies still queued from the run
+// (events, late acknowledgements) are skipped
+bool cleanup(QLocalSocket& socket, QByteArray& buffer, quint32 requestId, int keyCount) {
+    socket.write(buildCleanup(requestId, keyCount));
+    socket.flush();
+    while (socket.waitForReadyRead(5000)) {
+        buffer += socket.readAll();
+        QList<QByteArray> frames;
+        if (!SettingsProtocol::takeFrames(&buffer, &frames)) return false;
+        for (const QByteArray& frame : std::as_const(frames)) {
+            QDataStream in(frame);
+            in.setVersion(QDataStream::Qt_6_0);
+            quint32 id = 0;
+            quint8 type = 0;
+            quint8 status = SettingsProtocol::BadRequest;
+            in >> id >> type >> status;
+            if (id == requestId && type == SettingsProtocol::Reply) return status == SettingsProtocol::Ok;
+        }
+    }
+    return false;
+}
+
+QByteArray buildSubscribe() {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << quint32(0) << quint8(SettingsProtocol::Subscribe) << quint32(0);
+
+    QByteArray frame;
+    SettingsProtocol::appendFrame(&frame, payload);
+    return frame;
+}
+
+qint64 percentile(const QList<qint64>& sorted, double fraction) {
+    if (sorted.isEmpty()) return 0;
+    const qsizetype index = std::min(sorted.size() - 1, qsizetype(fraction * sorted.size()));
+    return sorted[index];
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Load generator for the local settings service");
+    parser.addHelpOption();
+    QCommandLineOption serverOption("server", "Server name.", "name", SettingsProtocol::DefaultServerName);
+    QCommandLineOption requestsOption("requests", "Number of requests.", "n", "10000");
+    QCommandLineOption batchOption("batch", "Keys per request.", "n", "16");
+    QCommandLineOption pipelineOption("pipeline", "Requests in flight.", "n", "32");
+    QCommandLineOption writesOption("writes", "Percentage of set requests.", "percent", "0");
+    QCommandLineOption subscribeOption("subscribe", "Subscribe to all groups and count events.");
+    QCommandLineOption keyOption("key", "Key to read, as group/key; may be repeated.", "group/key");
+    parser.addOptions({serverOption, requestsOption, batchOption, pipelineOption, writesOption, subscribeOption, keyOption});
+    parser.process(app);
+
+    const int requests = std::max(1, parser.value(requestsOption).toInt());
+    const int batch = std::max(1, parser.value(batchOption).toInt());
+    const int pipeline = std::max(1, parser.value(pipelineOption).toInt());
+    const int writes = std::clamp(parser.value(writesOption).toInt(), 0, 100);
+
+    QList<Key> keys;
+    const QStringList paths = parser.values(keyOption);
+    for (const QString& path : paths) {
+        const int slash = path.indexOf('/');
+        if (slash <= 0) {
+            err() << "invalid key '" << path << "', expected group/key\n";
+            return 2;
+        }
+        keys.append({path.left(slash), path.mid(slash + 1)});
+    }
+    if (keys.isEmpty()) {
+        keys.append({"main_group", "3"});
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(parser.value(serverOption));
+    if (!socket.waitForConnected(3000)) {
+        err() << "cannot connect: " << socket.errorString() << '\n';
+        return 1;
+    }
+
+    QByteArray outgoing;
+    if (parser.isSet(subscribeOption)) {
+        outgoing = buildSubscribe();
+    }
+
+    QHash<quint32, qint64> sentAt;
+    QList<qint64> latencies;
+    latencies.reserve(requests);
+    QByteArray buffer;
+    quint32 nextId = 1;
+    int cursor = 0;
+    int sent = 0;
+    int failed = 0;
+    int writesSent = 0;
+    qint64 events = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (latencies.size() + failed < requests) {
+        while (sent < requests && sentAt.size() < pipeline) {
+            const bool write = int(QRandomGenerator::global()->bounded(100)) < writes;
+            if (write) ++writesSent;
+            outgoing += buildRequest(nextId, write, keys, batch, &cursor);
+            sentAt.insert(nextId++, timer.nsecsElapsed());
+            ++sent;
+        }
+        if (!outgoing.isEmpty()) {
+            socket.write(outgoing);
+            outgoing.clear();
+            socket.flush();
+        }
+
+        if (!socket.waitForReadyRead(5000)) {
+            err() << "no reply: " << socket.errorString() << '\n';
+            return 1;
+        }
+        buffer += socket.readAll();
+
+        QList<QByteArray> frames;
+        if (!SettingsProtocol::takeFrames(&buffer, &frames)) {
+            err() << "corrupt reply stream\n";
+            return 1;
+        }
+        const qint64 now = timer.nsecsElapsed();
+        for (const QByteArray& frame : std::as_const(frames)) {
+            QDataStream in(frame);
+            in.setVersion(QDataStream::Qt_6_0);
+            quint32 requestId = 0;
+            quint8 type = 0;
+            in >> requestId >> type;
+            if (type == SettingsProtocol::Event) {
+                quint32 count = 0;
+                in >> count;
+                events += count;
+                continue;
+            }
+
+            quint8 status = SettingsProtocol::BadRequest;
+            in >> status;
+            auto it = sentAt.find(requestId);
+            if (it == sentAt.end()) continue; // subscribe acknowledgement
+            if (status == SettingsProtocol::Ok) {
+                latencies.append(now - *it);
+            } else {
+                ++failed;
+            }
+            sentAt.erase(it);
+        }
+    }
+    const qint64 elapsedNs = std::max<qint64>(1, timer.nsecsElapsed());
+
+    if (writesSent > 0 && !cleanup(socket, buffer, nextId, std::min(cursor, LoadKeyCount))) {
+        err() << "cannot remove the " << LoadGroup << " group: " << socket.errorString() << '\n';
+        ++failed;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const double seconds = elapsedNs / 1e9;
+    out() << "requests:   " << requests << " x " << batch << " keys, " << writes << "% writes, "
+          << pipeline << " in flight, " << failed << " failed\n"
+          << "elapsed:    " << QString::number(elapsedNs / 1e6, 'f', 1) << " ms\n"
+          << "throughput: " << QString::number(requests / seconds, 'f', 0) << " requests/s, "
+          << QString::number(double(requests) * batch / seconds, 'f', 0) << " keys/s\n"
+          << "latency us: p50 " << percentile(latencies, 0.50) / 1000
+          << ", p95 " << percentile(latencies, 0.95) / 1000
+          << ", p99 " << percentile(latencies, 0.99) / 1000
+          << ", max " << (latencies.isEmpty() ? 0 : latencies.last() / 1000) << '\n';
+    if (parser.isSet(subscribeOption)) {
+        out() << "events:     " << events << " keys\n";
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "settingslock.h"
+#include "settingsmetrics.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+qint64 now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QByteArray siteName(const char* site) {
+    // Drop the directory part of __FILE__
+    QByteArray name(site);
+    const qsizetype slash = qMax(name.lastIndexOf('/'), name.lastIndexOf('\\'));
+    return slash >= 0 ? name.mid(slash + 1) : name;
+}
+}
+
+SettingsLock::Acquisition SettingsLock::lock(Mode mode) {
+    Acquisition acquisition;
+    if (!isProfiling() && !SettingsMetrics::isEnabled()) {
+        if (mode == Read) {
+            rwLock.lockForRead();
+        } else {
+            rwLock.lockForWrite();
+        }
+        return acquisition;
+    }
+
+    const qint64 start = now();
+    if (mode == Read) {
+        acquisition.contended = !rwLock.tryLockForRead();
+        if (acquisition.contended) rwLock.lockForRead();
+    } else {
+        acquisition.contended = !rwLock.tryLockForWrite();
+        if (acquisition.contended) rwLock.lockForWrite();
+    }
+    acquisition.acquiredAt = now();
+    acquisition.waitNs = acquisition.acquiredAt - start;
+    SettingsMetrics::record(SettingsMetrics::LockWaitTime, acquisition.waitNs);
+    return acquisition;
+}
+
+void SettingsLock::unlock(Mode mode, const char* site, const Acquisition& acquisition) {
+    const qint64 releasedAt = acquisition.acquiredAt >= 0 && isProfiling() ? now() : -1;
+    rwLock.unlock();
+    if (releasedAt < 0) return;
+
+    const quint64 waitNs = quint64(acquisition.waitNs);
+    const quint64 holdNs = quint64(releasedAt - acquisition.acquiredAt);
+
+    QMutexLocker locker(&profileMutex);
+    SiteProfile& entry = sites[qMakePair(site, int(mode))];
+    if (entry.acquisitions == 0) {
+        entry.site = siteName(site);
+        entry.mode = mode;
+    }
+    ++entry.acquisitions;
+    if (acquisition.contended) ++entry.contended;
+    entry.waitNs += waitNs;
+    entry.maxWaitNs = qMax(entry.maxWaitNs, waitNs);
+    entry.holdNs += holdNs;
+    entry.maxHoldNs = qMax(entry.maxHoldNs, holdNs);
+}
+
+QList<SettingsLock::SiteProfile> SettingsLock::profile() const {
+    QList<SiteProfile> result;
+    {
+        QMutexLocker locker(&profileMutex);
+        result = sites.values();
+    }
+    std::sort(result.begin(), result.end(), [](const SiteProfile& a, const SiteProfile& b) {
+        return a.waitNs > b.waitNs;
+    });
+    return result;
+}
+
+void SettingsLock::resetProfile() {
+    QMutexLocker locker(&profileMutex);
+    sites.clear();
+}
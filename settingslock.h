@@ -0,0 +1,114 @@
+#ifndef SETTINGSLOCK_H
+#define SETTINGSLOCK_H
+
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+#include <atomic>
+
+// Call site recorded by the lockers below
+#define SETTINGS_LOCK_SITE __FILE__ ":" QT_STRINGIFY(__LINE__)
+
+// QReadWriteLock that can record, per call site, how long callers waited for it
+// and how long they held it. Unprofiled, the only overhead is a relaxed atomic
+// load per acquisition. Wait times also go to SettingsMetrics when it is enabled.
+class SettingsLock
+{
+public:
+    enum Mode {
+        Read,
+        Write
+    };
+
+    struct SiteProfile {
+        QByteArray site;
+        Mode mode = Read;
+        quint64 acquisitions = 0;
+        // Acquisitions that could not take the lock immediately
+        quint64 contended = 0;
+        quint64 waitNs = 0;
+        quint64 maxWaitNs = 0;
+        quint64 holdNs = 0;
+        quint64 maxHoldNs = 0;
+    };
+
+    // Filled in by lock() and handed back to unlock()
+    struct Acquisition {
+        qint64 acquiredAt = -1;
+        qint64 waitNs = 0;
+        bool contended = false;
+    };
+
+    void setProfiling(bool on) { profiling.store(on, std::memory_order_relaxed); }
+    bool isProfiling() const { return profiling.load(std::memory_order_relaxed); }
+    // Sites sorted by total wait time, longest first
+    QList<SiteProfile> profile() const;
+    void resetProfile();
+
+    Acquisition lock(Mode mode);
+    void unlock(Mode mode, const char* site, const Acquisition& acquisition);
+
+private:
+    QReadWriteLock rwLock;
+    std::atomic<bool> profiling{false};
+
+    mutable QMutex profileMutex;
+    // Keyed by the site literal and the mode
+    QHash<QPair<const char*, int>, SiteProfile> sites;
+};
+
+class SettingsReadLocker
+{
+public:
+    SettingsReadLocker(SettingsLock* lock, const char* site) : lock_(lock), site_(site) { relock(); }
+    ~SettingsReadLocker() { unlock(); }
+
+    void unlock() {
+        if (!locked_) return;
+        lock_->unlock(SettingsLock::Read, site_, acquisition_);
+        locked_ = false;
+    }
+    void relock() {
+        if (locked_) return;
+        acquisition_ = lock_->lock(SettingsLock::Read);
+        locked_ = true;
+    }
+
+private:
+    Q_DISABLE_COPY(SettingsReadLocker)
+
+    SettingsLock* lock_;
+    const char* site_;
+    SettingsLock::Acquisition acquisition_;
+    bool locked_ = false;
+};
+
+class SettingsWriteLocker
+{
+public:
+    SettingsWriteLocker(SettingsLock* lock, const char* site) : lock_(lock), site_(site) { relock(); }
+    ~SettingsWriteLocker() { unlock(); }
+
+    void unlock() {
+        if (!locked_) return;
+        lock_->unlock(SettingsLock::Write, site_, acquisition_);
+        locked_ = false;
+    }
+    void relock() {
+        if (locked_) return;
+        acquisition_ = lock_->lock(SettingsLock::Write);
+        locked_ = true;
+    }
+
+private:
+    Q_DISABLE_COPY(SettingsWriteLocker)
+
+    SettingsLock* lock_;
+    const char* site_;
+    SettingsLock::Acquisition acquisition_;
+    bool locked_ = false;
+};
+
+#endif // SETTINGSLOCK_H
@@ -0,0 +1,205 @@
+#include "settingsmetrics.h"
+#include <QMutex>
+#include <QList>
+#include <chrono>
+
+namespace {
+struct ThreadBlock {
+    struct Histogram {
+        std::atomic<quint64> count{0};
+        std::atomic<quint64> totalNs{0};
+        std::atomic<quint64> maxNs{0};
+        std::atomic<quint64> buckets[SettingsMetrics::BucketCount] = {};
+    };
+
+    // Matches `generation` below unless reset() ran since the last write
+    std::atomic<quint64> generation{0};
+    std::atomic<quint64> counters[SettingsMetrics::CounterCount] = {};
+    Histogram timers[SettingsMetrics::TimerCount];
+};
+
+// Only the owning thread writes a block, so a plain load and store is enough
+void bump(std::atomic<quint64>& value, quint64 amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void clearBlock(ThreadBlock& block) {
+    for (auto& counter : block.counters) counter.store(0, std::memory_order_relaxed);
+    for (auto& timer : block.timers) {
+        timer.count.store(0, std::memory_order_relaxed);
+        timer.totalNs.store(0, std::memory_order_relaxed);
+        timer.maxNs.store(0, std::memory_order_relaxed);
+        for (auto& bucket : timer.buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void addBlock(SettingsMetrics::Report& report, const ThreadBlock& block) {
+    for (int i = 0; i < SettingsMetrics::CounterCount; ++i) {
+        report.counters[i] += block.counters[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < SettingsMetrics::TimerCount; ++i) {
+        const ThreadBlock::Histogram& from = block.timers[i];
+        SettingsMetrics::Histogram& to = report.timers[i];
+        to.count += from.count.load(std::memory_order_relaxed);
+        to.totalNs += from.totalNs.load(std::memory_order_relaxed);
+        to.maxNs = qMax(to.maxNs, from.maxNs.load(std::memory_order_relaxed));
+        for (int bucket = 0; bucket < SettingsMetrics::BucketCount; ++bucket) {
+            to.buckets[bucket] += from.buckets[bucket].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void addReport(SettingsMetrics::Report& report, const SettingsMetrics::Report& other) {
+    for (int i = 0; i < SettingsMetrics::CounterCount; ++i) {
+        report.counters[i] += other.counters[i];
+    }
+    for (int i = 0; i < SettingsMetrics::TimerCount; ++i) {
+        SettingsMetrics::Histogram& to = report.timers[i];
+        const SettingsMetrics::Histogram& from = other.timers[i];
+        to.count += from.count;
+        to.totalNs += from.totalNs;
+        to.maxNs = qMax(to.maxNs, from.maxNs);
+        for (int bucket = 0; bucket < SettingsMetrics::BucketCount; ++bucket) {
+            to.buckets[bucket] += from.buckets[bucket];
+        }
+    }
+}
+
+struct Registry {
+    QMutex mutex;
+    QList<ThreadBlock*> blocks;
+    // Totals of threads that have exited
+    SettingsMetrics::Report retired;
+    std::atomic<quint64> generation{0};
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Registers the calling thread's block on first use and folds it into the
+// retired totals when the thread exits
+struct ThreadBlockHolder {
+    ThreadBlock* block = nullptr;
+
+    ~ThreadBlockHolder() {
+        if (!block) return;
+        Registry& reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        if (block->generation.load(std::memory_order_relaxed) == reg.generation.load(std::memory_order_relaxed)) {
+            addBlock(reg.retired, *block);
+        }
+        reg.blocks.removeOne(block);
+        delete block;
+    }
+};
+
+ThreadBlock& threadBlock() {
+    thread_local ThreadBlockHolder holder;
+    Registry& reg = registry();
+    if (!holder.block) {
+        holder.block = new ThreadBlock;
+        QMutexLocker locker(&reg.mutex);
+        holder.block->generation.store(reg.generation.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        reg.blocks.append(holder.block);
+    }
+
+    // reset() leaves clearing to the owner, which is the only writer
+    const quint64 generation = reg.generation.load(std::memory_order_relaxed);
+    if (holder.block->generation.load(std::memory_order_relaxed) != generation) {
+        clearBlock(*holder.block);
+        holder.block->generation.store(generation, std::memory_order_relaxed);
+    }
+    return *holder.block;
+}
+}
+
+std::atomic<bool> SettingsMetrics::enabled{false};
+
+void SettingsMetrics::setEnabled(bool on) {
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+qint64 SettingsMetrics::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SettingsMetrics::addSlow(Counter counter, quint64 amount) {
+    bump(threadBlock().counters[counter], amount);
+}
+
+void SettingsMetrics::recordSlow(Timer timer, qint64 nanoseconds) {
+    const quint64 ns = quint64(qMax<qint64>(nanoseconds, 0));
+    ThreadBlock::Histogram& histogram = threadBlock().timers[timer];
+
+    int bucket = 0;
+    for (quint64 rest = ns >> 1; rest && bucket < BucketCount - 1; rest >>= 1) ++bucket;
+
+    bump(histogram.count, 1);
+    bump(histogram.totalNs, ns);
+    bump(histogram.buckets[bucket], 1);
+    if (ns > histogram.maxNs.load(std::memory_order_relaxed)) {
+        histogram.maxNs.store(ns, std::memory_order_relaxed);
+    }
+}
+
+SettingsMetrics::Report SettingsMetrics::report() {
+    Registry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    Report result = reg.retired;
+    const quint64 generation = reg.generation.load(std::memory_order_relaxed);
+    for (const ThreadBlock* block : std::as_const(reg.blocks)) {
+        // Not cleared by its thread yet since the last reset()
+        if (block->generation.load(std::memory_order_relaxed) != generation) continue;
+        addBlock(result, *block);
+    }
+    return result;
+}
+
+void SettingsMetrics::reset() {
+    Registry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    reg.retired = Report();
+    reg.generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+qint64 SettingsMetrics::Histogram::percentileNs(double fraction) const {
+    if (count == 0) return 0;
+    const quint64 target = qMax<quint64>(1, quint64(fraction * count + 0.5));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= target) return qMin<qint64>(qint64(1) << (bucket + 1), qint64(maxNs));
+    }
+    return qint64(maxNs);
+}
+
+const char* SettingsMetrics::name(Counter counter) {
+    switch (counter) {
+    case Gets: return "gets";
+    case Sets: return "sets";
+    case Saves: return "saves";
+    case StoreSyncs: return "store syncs";
+    case ExternalReloads: return "external reloads";
+    case BytesWritten: return "bytes written";
+    case AutoSaves: return "auto-saves";
+    case FilterRejects: return "filter rejects";
+    case FilterFalsePositives: return "filter false positives";
+    case CounterCount: break;
+    }
+    return "";
+}
+
+const char* SettingsMetrics::name(Timer timer) {
+    switch (timer) {
+    case GetTime: return "get";
+    case SetTime: return "set";
+    case LockWaitTime: return "lock wait";
+    case SaveTime: return "save";
+    case PageBuildTime: return "page build";
+    case TimerCount: break;
+    }
+    return "";
+}
@@ -0,0 +1,106 @@
+#ifndef SETTINGSMETRICS_H
+#define SETTINGSMETRICS_H
+
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+
+// Process-wide counters and latency histograms for the settings engine.
+// Off by default; while off, every hook is a single relaxed atomic load.
+// Each thread records into its own block without locking or contended atomics,
+// report() sums the blocks.
+class SettingsMetrics
+{
+public:
+    enum Counter {
+        Gets,
+        Sets,
+        // Commits to the journal or the store
+        Saves,
+        // Full writes of the backing store (compactions)
+        StoreSyncs,
+        // Edits by other processes picked up from the store
+        ExternalReloads,
+        BytesWritten,
+        AutoSaves,
+        // Lookups of evicted groups answered by their key filter (BoundedSettingsCache)
+        FilterRejects,
+        // Lookups a key filter let through that still missed after the reload
+        FilterFalsePositives,
+        CounterCount
+    };
+
+    enum Timer {
+        GetTime,
+        SetTime,
+        LockWaitTime,
+        SaveTime,
+        PageBuildTime,
+        TimerCount
+    };
+
+    // Bucket i counts durations in [2^i, 2^(i+1)) nanoseconds
+    static constexpr int BucketCount = 40;
+
+    struct Histogram {
+        quint64 count = 0;
+        quint64 totalNs = 0;
+        quint64 maxNs = 0;
+        std::array<quint64, BucketCount> buckets{};
+
+        qint64 meanNs() const { return count ? qint64(totalNs / count) : 0; }
+        // Upper bound of the bucket holding the given fraction (0..1) of samples
+        qint64 percentileNs(double fraction) const;
+    };
+
+    struct Report {
+        std::array<quint64, CounterCount> counters{};
+        std::array<Histogram, TimerCount> timers{};
+    };
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on);
+
+    static void add(Counter counter, quint64 amount = 1) {
+        if (isEnabled()) addSlow(counter, amount);
+    }
+    static void record(Timer timer, qint64 nanoseconds) {
+        if (isEnabled()) recordSlow(timer, nanoseconds);
+    }
+
+    static Report report();
+    static void reset();
+
+    static const char* name(Counter counter);
+    static const char* name(Timer timer);
+
+    // Records the time until destruction or stop(); reads no clock while disabled
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Timer timer) : timer_(timer), start_(isEnabled() ? now() : -1) {}
+        ~ScopedTimer() { stop(); }
+
+        void stop() {
+            if (start_ < 0) return;
+            record(timer_, now() - start_);
+            start_ = -1;
+        }
+
+    private:
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        Timer timer_;
+        qint64 start_;
+    };
+
+private:
+    static qint64 now();
+    static void addSlow(Counter counter, quint64 amount);
+    static void recordSlow(Timer timer, qint64 nanoseconds);
+
+    static std::atomic<bool> enabled;
+};
+
+#endif // SETTINGSMETRICS_H
@@ -0,0 +1,32 @@
+#include "settingsoptionmodel.h"
+
+SettingsOptionModel::SettingsOptionModel(const QStringList& options, QObject* parent)
+    : QAbstractListModel(parent), options_(options)
+{
+    rows_.reserve(options_.size());
+    for (int row = 0; row < options_.size(); ++row) {
+        // Keep the first occurrence, matching QComboBox::findText
+        if (!rows_.contains(options_[row])) {
+            rows_.insert(options_[row], row);
+        }
+    }
+}
+
+int SettingsOptionModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : options_.size();
+}
+
+QVariant SettingsOptionModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= options_.size()) return QVariant();
+    if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        return options_[index.row()];
+    }
+    return QVariant();
+}
+
+int SettingsOptionModel::indexOf(const QString& option) const
+{
+    return rows_.value(option, -1);
+}
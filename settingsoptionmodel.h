@@ -0,0 +1,29 @@
+#ifndef SETTINGSOPTIONMODEL_H
+#define SETTINGSOPTIONMODEL_H
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QHash>
+
+// Immutable option list shared by every combo box that offers the same choices.
+// Text-to-row lookups go through a hash instead of QComboBox::findText.
+class SettingsOptionModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit SettingsOptionModel(const QStringList& options, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    int indexOf(const QString& option) const;
+    QString option(int row) const { return options_.value(row); }
+    const QStringList& options() const { return options_; }
+
+private:
+    QStringList options_;
+    QHash<QString, int> rows_;
+};
+
+#endif // SETTINGSOPTIONMODEL_H
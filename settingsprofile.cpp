@@ -0,0 +1,248 @@
+#include "settingsprofile.h"
+#include <QIODevice>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QtConcurrent>
+#include <QtEndian>
+
+namespace {
+const char BinaryMagic[] = "SCP1";
+const qint64 BinaryMagicSize = 4;
+const quint32 MaxRecordSize = 16 * 1024 * 1024;
+// Records held in memory at once, and records per parallel task within a batch
+const int BatchSize = 16384;
+const int ChunkSize = 1024;
+
+using Range = QPair<qsizetype, qsizetype>;
+
+struct Record {
+    const QString* group;
+    const QString* key;
+    const QVariant* value;
+};
+
+struct ParsedChunk {
+    QList<SettingsCache::Change> changes;
+    QString error;
+};
+
+QList<Range> chunksOf(qsizetype size) {
+    QList<Range> chunks;
+    for (qsizetype start = 0; start < size; start += ChunkSize) {
+        chunks.append({start, qMin(size, start + ChunkSize)});
+    }
+    return chunks;
+}
+
+QByteArray encodeJson(const QList<Record>& records, const Range& range) {
+    QByteArray out;
+    for (qsizetype i = range.first; i < range.second; ++i) {
+        const Record& record = records[i];
+        QJsonValue value = QJsonValue::fromVariant(*record.value);
+        // Types without a JSON form are written as their string conversion
+        if (value.isNull() && record.value->isValid() && !record.value->isNull()) {
+            value = record.value->toString();
+        }
+        const QJsonObject object{{"group", *record.group}, {"key", *record.key}, {"value", value}};
+        out += QJsonDocument(object).toJson(QJsonDocument::Compact);
+        out += '\n';
+    }
+    return out;
+}
+
+QByteArray encodeBinary(const QList<Record>& records, const Range& range) {
+    QByteArray out;
+    QByteArray payload;
+    for (qsizetype i = range.first; i < range.second; ++i) {
+        const Record& record = records[i];
+        payload.clear();
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_6_0);
+        stream << *record.group << *record.key << *record.value;
+
+        const quint32 length = qToBigEndian(quint32(payload.size()));
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out += payload;
+    }
+    return out;
+}
+
+ParsedChunk parseJson(const QList<QByteArray>& lines, qint64 firstLine, const Range& range) {
+    ParsedChunk result;
+    result.changes.reserve(range.second - range.first);
+    for (qsizetype i = range.first; i < range.second; ++i) {
+        if (lines[i].isEmpty()) continue;
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(lines[i], &parseError);
+        const QJsonObject object = document.object();
+        SettingsCache::Change change;
+        change.group = object.value("group").toString();
+        change.key = object.value("key").toString();
+        change.value = object.value("value").toVariant();
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()
+            || change.group.isEmpty() || change.key.isEmpty() || !object.contains("value")) {
+            result.error = QString("line %1: expected {\"group\": ..., \"key\": ..., \"value\": ...}").arg(firstLine + i);
+            return result;
+        }
+        result.changes.append(change);
+    }
+    return result;
+}
+
+ParsedChunk parseBinary(const QList<QByteArray>& records, qint64 firstRecord, const Range& range) {
+    ParsedChunk result;
+    result.changes.reserve(range.second - range.first);
+    for (qsizetype i = range.first; i < range.second; ++i) {
+        QDataStream stream(records[i]);
+        stream.setVersion(QDataStream::Qt_6_0);
+        SettingsCache::Change change;
+        stream >> change.group >> change.key >> change.value;
+        if (stream.status() != QDataStream::Ok || change.group.isEmpty() || change.key.isEmpty()) {
+            result.error = QString("record %1 is corrupt").arg(firstRecord + i);
+            return result;
+        }
+        result.changes.append(change);
+    }
+    return result;
+}
+
+// Parses one batch in parallel and appends it in file order
+bool parseBatch(const QList<QByteArray>& batch, qint64 first, SettingsProfile::Format format,
+                QList<SettingsCache::Change>* changes, QString* error) {
+    const QList<ParsedChunk> parsed = QtConcurrent::blockingMapped<QList<ParsedChunk>>(
+        chunksOf(batch.size()), [&](const Range& range) {
+            return format == SettingsProfile::Json ? parseJson(batch, first, range)
+                                                   : parseBinary(batch, first, range);
+        });
+    for (const ParsedChunk& chunk : parsed) {
+        if (!chunk.error.isEmpty()) {
+            if (error) *error = chunk.error;
+            return false;
+        }
+        changes->append(chunk.changes);
+    }
+    return true;
+}
+
+bool fail(QString* error, const QString& message) {
+    if (error) *error = message;
+    return false;
+}
+}
+
+SettingsProfile::Format SettingsProfile::formatForFileName(const QString& fileName) {
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "json" || suffix == "jsonl") return Json;
+    if (suffix == "scp") return Binary;
+    return UnknownFormat;
+}
+
+bool SettingsProfile::write(QIODevice* device, Format format, const SettingsCache::Snapshot& values, QString* error) {
+    if (format == UnknownFormat) return fail(error, "unknown profile format");
+    if (format == Binary && device->write(BinaryMagic, BinaryMagicSize) != BinaryMagicSize) {
+        return fail(error, device->errorString());
+    }
+
+    QList<Record> batch;
+    batch.reserve(BatchSize);
+    auto flush = [&]() {
+        const QList<QByteArray> encoded = QtConcurrent::blockingMapped<QList<QByteArray>>(
+            chunksOf(batch.size()), [&](const Range& range) {
+                return format == Json ? encodeJson(batch, range) : encodeBinary(batch, range);
+            });
+        batch.clear();
+        for (const QByteArray& bytes : encoded) {
+            if (device->write(bytes) != bytes.size()) return false;
+        }
+        return true;
+    };
+
+    for (auto groupIt = values.begin(); groupIt != values.end(); ++groupIt) {
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            batch.append({&groupIt.key(), &keyIt.key(), &keyIt.value()});
+            if (batch.size() == BatchSize && !flush()) {
+                return fail(error, device->errorString());
+            }
+        }
+    }
+    if (!flush()) return fail(error, device->errorString());
+
+    if (format == Binary) {
+        const quint32 end = 0;
+        if (device->write(reinterpret_cast<const char*>(&end), sizeof(end)) != sizeof(end)) {
+            return fail(error, device->errorString());
+        }
+    }
+    return true;
+}
+
+bool SettingsProfile::read(QIODevice* device, Format format, QList<SettingsCache::Change>* changes, QString* error) {
+    QList<QByteArray> batch;
+    batch.reserve(BatchSize);
+    qint64 first = 1;
+
+    if (format == Json) {
+        qint64 lineNumber = 0;
+        while (!device->atEnd()) {
+            ++lineNumber;
+            if (batch.isEmpty()) first = lineNumber;
+            // Room for the longest record and its newline; anything longer is cut off
+            const QByteArray line = device->readLine(qint64(MaxRecordSize) + 1);
+            if (!line.endsWith('\n') && !device->atEnd()) {
+                return fail(error, QString("line %1 is too large").arg(lineNumber));
+            }
+            batch.append(line.trimmed());
+            if (batch.size() == BatchSize) {
+                if (!parseBatch(batch, first, format, changes, error)) return false;
+                batch.clear();
+            }
+        }
+        return parseBatch(batch, first, format, changes, error);
+    }
+
+    if (format != Binary) return fail(error, "unknown profile format");
+    if (device->read(BinaryMagicSize) != QByteArray(BinaryMagic, BinaryMagicSize)) {
+        return fail(error, "not a settings profile");
+    }
+
+    qint64 recordNumber = 0;
+    for (;;) {
+        quint32 length = 0;
+        if (device->read(reinterpret_cast<char*>(&length), sizeof(length)) != sizeof(length)) {
+            return fail(error, "truncated settings profile");
+        }
+        length = qFromBigEndian(length);
+        if (length == 0) break;
+        if (length > MaxRecordSize) return fail(error, QString("record %1 is too large").arg(recordNumber + 1));
+
+        QByteArray record = device->read(length);
+        if (record.size() != qsizetype(length)) return fail(error, "truncated settings profile");
+
+        if (batch.isEmpty()) first = recordNumber + 1;
+        ++recordNumber;
+        batch.append(record);
+        if (batch.size() == BatchSize) {
+            if (!parseBatch(batch, first, format, changes, error)) return false;
+            batch.clear();
+        }
+    }
+    return parseBatch(batch, first, format, changes, error);
+}
+
+bool SettingsProfile::exportFrom(SettingsCache& cache, QIODevice* device, Format format, QString* error) {
+    return write(device, format, cache.snapshot(), error);
+}
+
+bool SettingsProfile::importInto(SettingsCache& cache, QIODevice* device, Format format, QString* error) {
+    QList<SettingsCache::Change> changes;
+    if (!read(device, format, &changes, error)) return false;
+
+    QStringList errors;
+    if (!cache.commitChanges(changes, &errors)) {
+        return fail(error, errors.join('\n'));
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef SETTINGSPROFILE_H
+#define SETTINGSPROFILE_H
+
+#include "settingscache.h"
+
+class QIODevice;
+
+// Streaming import and export of settings profiles.
+//
+//   Json    JSON Lines: one {"group": ..., "key": ..., "value": ...} object per line
+//   Binary  "SCP1" header, then per value a big-endian quint32 length and a
+//           QDataStream (Qt_6_0) record of group, key and QVariant; a zero
+//           length ends the stream. Keeps every QVariant type intact.
+//
+// Files are processed in fixed-size batches whose records are parsed or
+// encoded in parallel with QtConcurrent, so only one batch of raw input or
+// output is in memory at a time, and no record (JSON line or binary record)
+// may exceed 16 MiB. The parsed values are not bounded: read() returns all of
+// them and importInto() commits them to the in-memory cache as one
+// transaction, so importing needs memory proportional to the number of values
+// in the profile, roughly twice while the commit builds its snapshots.
+class SettingsProfile
+{
+public:
+    enum Format {
+        UnknownFormat,
+        Json,
+        Binary
+    };
+
+    // .json/.jsonl and .scp
+    static Format formatForFileName(const QString& fileName);
+
+    static bool write(QIODevice* device, Format format, const SettingsCache::Snapshot& values, QString* error = nullptr);
+    static bool read(QIODevice* device, Format format, QList<SettingsCache::Change>* changes, QString* error = nullptr);
+
+    // Exports the user scope, or imports a profile as a single validated commit
+    static bool exportFrom(SettingsCache& cache, QIODevice* device, Format format, QString* error = nullptr);
+    static bool importInto(SettingsCache& cache, QIODevice* device, Format format, QString* error = nullptr);
+};
+
+#endif // SETTINGSPROFILE_H
@@ -0,0 +1,71 @@
+#ifndef SETTINGSPROTOCOL_H
+#define SETTINGSPROTOCOL_H
+
+#include <QByteArray>
+#include <QList>
+#include <QtEndian>
+
+// Wire format of SettingsService. Every message is a frame: a big-endian quint32
+// payload length followed by a QDataStream (Qt_6_0) payload that starts with
+// quint32 requestId and quint8 MessageType. Clients may pipeline any number of
+// requests; replies come back in request order and carry the same requestId.
+//
+//   Get          quint32 n, n x (QString group, QString key)
+//   Set          quint32 n, n x (QString group, QString key, QVariant value)
+//   Remove       quint32 n, n x (QString group, QString key)
+//   Subscribe    quint32 n, n x QString group; no groups means all of them
+//   Reply        quint8 Status; for Get: quint32 n, n x (bool found, QVariant value)
+//   Event        requestId 0; quint32 n, n x (QString group, QString key, bool removed, QVariant value)
+//
+// Events are coalesced: a subscriber gets the latest value of each key changed
+// since the previous event, not every intermediate write.
+namespace SettingsProtocol {
+
+enum MessageType : quint8 {
+    Get = 1,
+    Set = 2,
+    Remove = 3,
+    Subscribe = 4,
+    Reply = 0x81,
+    Event = 0x82
+};
+
+enum Status : quint8 {
+    Ok = 0,
+    BadRequest = 1,
+    // A value failed validation; nothing from the request was applied
+    Rejected = 2
+};
+
+const char* const DefaultServerName = "TestLabs.TestSettings";
+const quint32 MaxFrameSize = 16 * 1024 * 1024;
+
+// Appends the length-prefixed frame for `payload` to `out`
+inline void appendFrame(QByteArray* out, const QByteArray& payload) {
+    const quint32 length = qToBigEndian(quint32(payload.size()));
+    out->append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out->append(payload);
+}
+
+// Moves every complete frame at the start of `buffer` into `frames`.
+// Returns false if the stream is corrupt (frame larger than MaxFrameSize).
+inline bool takeFrames(QByteArray* buffer, QList<QByteArray>* frames) {
+    qsizetype offset = 0;
+    bool ok = true;
+    while (buffer->size() - offset >= qsizetype(sizeof(quint32))) {
+        const quint32 length = qFromBigEndian<quint32>(buffer->constData() + offset);
+        if (length > MaxFrameSize) {
+            ok = false;
+            break;
+        }
+        if (buffer->size() - offset - qsizetype(sizeof(quint32)) < qsizetype(length)) break;
+        frames->append(buffer->mid(offset + sizeof(quint32), length));
+        offset += sizeof(quint32) + length;
+    }
+    buffer->remove(0, offset);
+    return ok;
+}
+
+}
+
+#endif // SETTINGSPROTOCOL_H
@@ -0,0 +1,274 @@
+#include "settingsschemaloader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QCborMap>
+#include <climits>
+
+namespace {
+// JSON and CBOR numbers come back as double or qlonglong; items expect int
+QVariant normalized(const QVariant& value) {
+    if (value.typeId() == QMetaType::Double) {
+        const double number = value.toDouble();
+        if (number == qint64(number) && number >= INT_MIN && number <= INT_MAX) {
+            return int(number);
+        }
+    } else if (value.typeId() == QMetaType::LongLong) {
+        const qlonglong number = value.toLongLong();
+        if (number >= INT_MIN && number <= INT_MAX) {
+            return int(number);
+        }
+    }
+    return value;
+}
+
+QString readString(QCborStreamReader& reader) {
+    QString result;
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        result += chunk.data;
+        chunk = reader.readString();
+    }
+    return result;
+}
+}
+
+SettingsSchemaLoader::SettingsSchemaLoader(FactoryResolver resolver)
+    : resolver(std::move(resolver))
+{
+}
+
+SettingsItem* SettingsSchemaLoader::load(const QString& fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(QString("cannot open %1: %2").arg(fileName, file.errorString()));
+        return nullptr;
+    }
+
+    const QByteArray data = file.readAll();
+    if (QFileInfo(fileName).suffix().compare("cbor", Qt::CaseInsensitive) == 0) {
+        return loadCbor(data);
+    }
+    return loadJson(data);
+}
+
+SettingsItem* SettingsSchemaLoader::loadJson(const QByteArray& data) {
+    error.clear();
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(data, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        fail(QString("%1 at offset %2").arg(parseError.errorString()).arg(parseError.offset));
+        return nullptr;
+    }
+    if (!document.isObject()) {
+        fail("the schema root must be an object");
+        return nullptr;
+    }
+
+    SettingsItem* root = nullptr;
+    if (!readJsonNode(document.object(), nullptr, &root)) {
+        delete root;
+        return nullptr;
+    }
+    return root;
+}
+
+SettingsItem* SettingsSchemaLoader::loadCbor(const QByteArray& data) {
+    error.clear();
+
+    QCborStreamReader reader(data);
+    SettingsItem* root = nullptr;
+    if (!readCborNode(reader, nullptr, &root)) {
+        delete root;
+        return nullptr;
+    }
+    return root;
+}
+
+bool SettingsSchemaLoader::readJsonNode(const QJsonObject& object, SettingsItem* parent, SettingsItem** item) {
+    Node node;
+    node.id = object.value("id").toString();
+    node.name = object.value("name").toString();
+    node.description = object.value("description").toString();
+    node.defaultValue = normalized(object.value("default").toVariant());
+    node.control = object.value("control").toString();
+    node.options = object.value("options").toObject().toVariantMap();
+    node.constraints = object.value("constraints").toObject().toVariantMap();
+    node.saving = object.value("saving").toBool(true);
+    node.enabledWhen = object.value("enabledWhen").toVariant();
+    node.visibleWhen = object.value("visibleWhen").toVariant();
+
+    *item = createItem(node, parent);
+    if (!*item) return false;
+
+    const QJsonArray children = object.value("items").toArray();
+    (*item)->reserveChildren(children.size());
+    for (const QJsonValue& child : children) {
+        if (!child.isObject()) {
+            return fail(QString("'%1' has an item that is not an object").arg(node.id));
+        }
+        SettingsItem* childItem = nullptr;
+        if (!readJsonNode(child.toObject(), *item, &childItem)) return false;
+    }
+    return true;
+}
+
+bool SettingsSchemaLoader::readCborNode(QCborStreamReader& reader, SettingsItem* parent, SettingsItem** item) {
+    if (!reader.isMap()) {
+        return fail(QString("expected a map at offset %1").arg(reader.currentOffset()));
+    }
+    reader.enterContainer();
+
+    Node node;
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (!reader.isString()) {
+            return fail(QString("expected a string key at offset %1").arg(reader.currentOffset()));
+        }
+        const QString key = readString(reader);
+
+        if (key == "items") {
+            if (*item) {
+                return fail(QString("'%1' has more than one item list").arg(node.id));
+            }
+            *item = createItem(node, parent);
+            if (!*item) return false;
+            if (!reader.isArray()) {
+                return fail(QString("the items of '%1' must be an array").arg(node.id));
+            }
+            if (reader.isLengthKnown()) {
+                (*item)->reserveChildren(int(reader.length()));
+            }
+
+            reader.enterContainer();
+            while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                SettingsItem* childItem = nullptr;
+                if (!readCborNode(reader, *item, &childItem)) return false;
+            }
+            reader.leaveContainer();
+            continue;
+        }
+
+        if (*item) {
+            return fail(QString("'%1': \"items\" must be the last key").arg(node.id));
+        }
+
+        // Values are small, so each one is read whole
+        const QCborValue value = QCborValue::fromCbor(reader);
+        if (key == "id") {
+            node.id = value.toString();
+        } else if (key == "name") {
+            node.name = value.toString();
+        } else if (key == "description") {
+            node.description = value.toString();
+        } else if (key == "default") {
+            node.defaultValue = normalized(value.toVariant());
+        } else if (key == "control") {
+            node.control = value.toString();
+        } else if (key == "options") {
+            node.options = value.toMap().toVariantMap();
+        } else if (key == "constraints") {
+            node.constraints = value.toMap().toVariantMap();
+        } else if (key == "saving") {
+            node.saving = value.toBool(true);
+        } else if (key == "enabledWhen") {
+            node.enabledWhen = value.toVariant();
+        } else if (key == "visibleWhen") {
+            node.visibleWhen = value.toVariant();
+        }
+    }
+
+    if (reader.lastError() != QCborError::NoError) {
+        return fail(reader.lastError().toString());
+    }
+    reader.leaveContainer();
+
+    if (!*item) {
+        *item = createItem(node, parent);
+    }
+    return *item != nullptr;
+}
+
+SettingsItem* SettingsSchemaLoader::createItem(const Node& node, SettingsItem* parent) {
+    if (node.id.isEmpty()) {
+        fail(QString("a node under '%1' has no id").arg(parent ? parent->id() : QString()));
+        return nullptr;
+    }
+
+    QList<SettingsCondition> enabledWhen;
+    QList<SettingsCondition> visibleWhen;
+    if (!readConditions(node.enabledWhen, node.id, &enabledWhen)
+        || !readConditions(node.visibleWhen, node.id, &visibleWhen)) {
+        return nullptr;
+    }
+
+    if (node.control.isEmpty()) {
+        auto* group = new SettingsItem(node.id, node.name, node.description, parent);
+        group->setEnabledWhen(enabledWhen);
+        group->setVisibleWhen(visibleWhen);
+        return group;
+    }
+    if (!parent) {
+        fail("the schema root must be a group");
+        return nullptr;
+    }
+
+    SettingsControlFactoryPtr factory;
+    if (resolver) {
+        factory = resolver(node.control, node.options);
+        if (!factory) {
+            fail(QString("'%1' has unknown control type '%2'").arg(node.id, node.control));
+            return nullptr;
+        }
+    }
+
+    auto* item = new SettingsItem(node.id, node.name, node.description, node.defaultValue, parent, factory, node.saving);
+    item->setControlType(node.control);
+    item->setConstraints(node.constraints);
+    item->setEnabledWhen(enabledWhen);
+    item->setVisibleWhen(visibleWhen);
+    return item;
+}
+
+bool SettingsSchemaLoader::readConditions(const QVariant& rule, const QString& id, QList<SettingsCondition>* conditions) {
+    if (!rule.isValid() || rule.isNull()) return true;
+
+    const QVariantList terms = rule.typeId() == QMetaType::QVariantList ? rule.toList() : QVariantList{rule};
+    for (const QVariant& term : terms) {
+        const QVariantMap map = term.toMap();
+        SettingsCondition condition;
+        condition.itemId = map.value("item").toString();
+        if (condition.itemId.isEmpty()) {
+            return fail(QString("'%1' has a rule term without an item").arg(id));
+        }
+
+        if (map.contains("equals")) {
+            condition.op = SettingsCondition::Equals;
+            condition.values.append(normalized(map.value("equals")));
+        } else if (map.contains("notEquals")) {
+            condition.op = SettingsCondition::NotEquals;
+            condition.values.append(normalized(map.value("notEquals")));
+        } else if (map.contains("in")) {
+            condition.op = SettingsCondition::In;
+            const QVariantList values = map.value("in").toList();
+            for (const QVariant& value : values) {
+                condition.values.append(normalized(value));
+            }
+        } else {
+            return fail(QString("'%1' has a rule term without equals, notEquals or in").arg(id));
+        }
+        conditions->append(condition);
+    }
+    return true;
+}
+
+bool SettingsSchemaLoader::fail(const QString& message) {
+    if (error.isEmpty()) {
+        error = message;
+    }
+    return false;
+}
@@ -0,0 +1,71 @@
+#ifndef SETTINGSSCHEMALOADER_H
+#define SETTINGSSCHEMALOADER_H
+
+#include "settingsitem.h"
+#include <QVariantMap>
+#include <functional>
+
+class QCborStreamReader;
+class QJsonObject;
+
+// Builds a SettingsItem tree from a JSON or CBOR schema. Every node has an id,
+// a name and optionally a description; nodes with a "control" are settings,
+// all others are groups whose children are listed in "items":
+//
+//   { "id": "root", "name": "Settings", "items": [
+//       { "id": "main_group", "name": "Main Settings", "items": [
+//           { "id": "3", "name": "Timeout", "default": 300,
+//             "control": "spinbox", "options": { "min": 100, "max": 10000 },
+//             "enabledWhen": { "item": "2", "equals": true } } ] } ] }
+//
+// "constraints" holds the validation rules of a setting (see SettingsValidator).
+// "enabledWhen" and "visibleWhen" take one term or an array of terms that must
+// all hold; a term names an item and one of "equals", "notEquals" or "in".
+//
+// CBOR input is read in one streaming pass; there "items" has to be the last
+// key of its node, since the item is created when its children start.
+// Widgets are not known here: `resolver` maps a control type and its options to
+// a factory (see SettingsFactoryPool). Without a resolver settings get no
+// factory, which is enough for headless tools that only need controlType().
+class SettingsSchemaLoader
+{
+public:
+    using FactoryResolver = std::function<SettingsControlFactoryPtr(const QString& control, const QVariantMap& options)>;
+
+    explicit SettingsSchemaLoader(FactoryResolver resolver = nullptr);
+
+    // Chooses the format from the suffix (.cbor, anything else is JSON).
+    // Returns the root item, owned by the caller, or nullptr on error.
+    SettingsItem* load(const QString& fileName);
+    SettingsItem* loadJson(const QByteArray& data);
+    SettingsItem* loadCbor(const QByteArray& data);
+
+    QString errorString() const { return error; }
+
+private:
+    struct Node {
+        QString id;
+        QString name;
+        QString description;
+        QVariant defaultValue;
+        QString control;
+        QVariantMap options;
+        QVariantMap constraints;
+        bool saving = true;
+        QVariant enabledWhen;
+        QVariant visibleWhen;
+    };
+
+    SettingsItem* createItem(const Node& node, SettingsItem* parent);
+    // `item` is set as soon as the node's item exists, so a failing child still
+    // leaves the partial tree reachable for cleanup
+    bool readJsonNode(const QJsonObject& object, SettingsItem* parent, SettingsItem** item);
+    bool readCborNode(QCborStreamReader& reader, SettingsItem* parent, SettingsItem** item);
+    bool readConditions(const QVariant& rule, const QString& id, QList<SettingsCondition>* conditions);
+    bool fail(const QString& message);
+
+    FactoryResolver resolver;
+    QString error;
+};
+
+#endif // SETTINGSSCHEMALOADER_H
@@ -0,0 +1,222 @@
+#include "settingsservice.h"
+#include "settingsprotocol.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+// Upper bound on how long a change waits before it is pushed to subscribers
+const int EventFlushIntervalMs = 10;
+// How long listen() waits to find out whether another server owns the name
+const int ProbeTimeoutMs = 500;
+
+bool readKeys(QDataStream& in, QList<QPair<QString, QString>>* keys) {
+    quint32 count = 0;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString group, key;
+        in >> group >> key;
+        keys->append({group, key});
+    }
+    return in.status() == QDataStream::Ok;
+}
+}
+
+SettingsService::SettingsService(QObject* parent)
+    : QObject(parent)
+    , server(new QLocalServer(this))
+    , flushTimer(new QTimer(this))
+{
+    // Only processes of the same user may connect
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(EventFlushIntervalMs);
+
+    connect(server, &QLocalServer::newConnection, this, &SettingsService::onNewConnection);
+    connect(flushTimer, &QTimer::timeout, this, &SettingsService::flushEvents);
+    connect(&SettingsCache::instance(), &SettingsCache::changesCommitted, this, &SettingsService::onChangesCommitted);
+}
+
+SettingsService::~SettingsService() {
+    close();
+}
+
+bool SettingsService::listen(const QString& name) {
+    // A server that crashed may have left its socket file behind; one that still
+    // accepts connections keeps it, and listen() then fails with AddressInUseError
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(ProbeTimeoutMs)) {
+        probe.disconnectFromServer();
+    } else {
+        QLocalServer::removeServer(name);
+    }
+    return server->listen(name);
+}
+
+void SettingsService::close() {
+    server->close();
+    const QList<Client*> remaining = clients;
+    for (Client* client : remaining) {
+        client->socket->disconnectFromServer();
+        removeClient(client);
+    }
+}
+
+QString SettingsService::errorString() const {
+    return server->errorString();
+}
+
+void SettingsService::onNewConnection() {
+    while (QLocalSocket* socket = server->nextPendingConnection()) {
+        Client* client = new Client;
+        client->socket = socket;
+        clients.append(client);
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, client]() { readClient(client); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, client]() { removeClient(client); });
+    }
+}
+
+void SettingsService::removeClient(Client* client) {
+    if (!clients.removeOne(client)) return;
+    client->socket->disconnect(this);
+    client->socket->deleteLater();
+    delete client;
+}
+
+void SettingsService::readClient(Client* client) {
+    client->buffer.append(client->socket->readAll());
+
+    QList<QByteArray> frames;
+    const bool ok = SettingsProtocol::takeFrames(&client->buffer, &frames);
+
+    // Replies to everything that arrived in one read go out in a single write
+    QByteArray replies;
+    for (const QByteArray& frame : std::as_const(frames)) {
+        handleRequest(client, frame, &replies);
+    }
+    if (!replies.isEmpty()) {
+        client->socket->write(replies);
+    }
+
+    if (!ok) {
+        qWarning() << "SettingsService: dropping client that sent an oversized frame";
+        client->socket->disconnectFromServer();
+    }
+}
+
+bool SettingsService::handleRequest(Client* client, const QByteArray& payload, QByteArray* replies) {
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 requestId = 0;
+    quint8 type = 0;
+    in >> requestId >> type;
+
+    SettingsCache& cache = SettingsCache::instance();
+    QByteArray reply;
+    QDataStream out(&reply, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << requestId << quint8(SettingsProtocol::Reply);
+
+    bool ok = in.status() == QDataStream::Ok;
+    switch (ok ? type : 0) {
+    case SettingsProtocol::Get: {
+        QList<QPair<QString, QString>> keys;
+        if (!(ok = readKeys(in, &keys))) break;
+        out << quint8(SettingsProtocol::Ok) << quint32(keys.size());
+        for (const auto& key : std::as_const(keys)) {
+            const QVariant value = cache.getValue(key.first, key.second);
+            out << value.isValid() << value;
+        }
+        break;
+    }
+    case SettingsProtocol::Set:
+    case SettingsProtocol::Remove: {
+        // One request is one commit
+        QList<SettingsCache::Change> changes;
+        quint32 count = 0;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            SettingsCache::Change change;
+            in >> change.group >> change.key;
+            if (type == SettingsProtocol::Set) {
+                in >> change.value;
+            } else {
+                change.removed = true;
+            }
+            changes.append(change);
+        }
+        if (!(ok = in.status() == QDataStream::Ok)) break;
+        out << quint8(cache.commitChanges(changes) ? SettingsProtocol::Ok : SettingsProtocol::Rejected);
+        break;
+    }
+    case SettingsProtocol::Subscribe: {
+        QSet<QString> groups;
+        quint32 count = 0;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QString group;
+            in >> group;
+            groups.insert(group);
+        }
+        if (!(ok = in.status() == QDataStream::Ok)) break;
+        client->subscribed = true;
+        client->groups = groups;
+        out << quint8(SettingsProtocol::Ok);
+        break;
+    }
+    default:
+        ok = false;
+        break;
+    }
+
+    if (!ok) {
+        QByteArray error;
+        QDataStream errorOut(&error, QIODevice::WriteOnly);
+        errorOut.setVersion(QDataStream::Qt_6_0);
+        errorOut << requestId << quint8(SettingsProtocol::Reply) << quint8(SettingsProtocol::BadRequest);
+        SettingsProtocol::appendFrame(replies, error);
+        return false;
+    }
+    SettingsProtocol::appendFrame(replies, reply);
+    return true;
+}
+
+void SettingsService::onChangesCommitted(const QList<SettingsCache::Change>& changes) {
+    bool queued = false;
+    for (Client* client : std::as_const(clients)) {
+        if (!client->subscribed) continue;
+        for (const SettingsCache::Change& change : changes) {
+            if (!client->groups.isEmpty() && !client->groups.contains(change.group)) continue;
+            client->pendingEvents.insert(change.group + '/' + change.key, change);
+            queued = true;
+        }
+    }
+
+    // Not restarted on every change, so a steady stream of writes cannot starve subscribers
+    if (queued && !flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void SettingsService::flushEvents() {
+    for (Client* client : std::as_const(clients)) {
+        if (client->pendingEvents.isEmpty()) continue;
+
+        QByteArray event;
+        QDataStream out(&event, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << quint32(0) << quint8(SettingsProtocol::Event) << quint32(client->pendingEvents.size());
+        for (const SettingsCache::Change& change : std::as_const(client->pendingEvents)) {
+            out << change.group << change.key << change.removed << change.value;
+        }
+        client->pendingEvents.clear();
+
+        QByteArray frame;
+        SettingsProtocol::appendFrame(&frame, event);
+        client->socket->write(frame);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef SETTINGSSERVICE_H
+#define SETTINGSSERVICE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+
+#include "settingscache.h"
+
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+
+// Serves the live SettingsCache of this process to other local processes over
+// a QLocalServer (see settingsprotocol.h for the framing). Sets are committed
+// to the store right away; subscribers are pushed coalesced change events.
+class SettingsService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SettingsService(QObject* parent = nullptr);
+    ~SettingsService();
+
+    bool listen(const QString& name);
+    void close();
+    QString errorString() const;
+
+private:
+    struct Client {
+        QLocalSocket* socket = nullptr;
+        QByteArray buffer;
+        bool subscribed = false;
+        // Empty while subscribed means every group
+        QSet<QString> groups;
+        // Latest pending change per "group/key"
+        QHash<QString, SettingsCache::Change> pendingEvents;
+    };
+
+    void onNewConnection();
+    void readClient(Client* client);
+    bool handleRequest(Client* client, const QByteArray& payload, QByteArray* replies);
+    void onChangesCommitted(const QList<SettingsCache::Change>& changes);
+    void flushEvents();
+    void removeClient(Client* client);
+
+    QLocalServer* server = nullptr;
+    QTimer* flushTimer = nullptr;
+    QList<Client*> clients;
+};
+
+#endif // SETTINGSSERVICE_H
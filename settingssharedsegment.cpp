@@ -0,0 +1,307 @@
+#include "settingssharedsegment.h"
+#include <QDataStream>
+#include <QDir>
+#include <QUrl>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+const quint32 SegmentMagic = 0x53435347; // "SCSG"
+const quint32 LayoutVersion = 2;
+const quint32 StaleFlag = 0x1;
+const int MaxReadAttempts = 1000;
+
+struct SegmentHeader {
+    quint32 magic;
+    quint32 layoutVersion;
+    std::atomic<quint32> sequence; // odd while a publish is in progress
+    quint32 capacity;
+    quint32 entryCount;
+    quint32 flags;
+    quint64 generation;
+};
+
+// Sorted by (hash, key); offsets are relative to the start of the segment
+struct SegmentEntry {
+    quint32 hash;
+    quint32 keyOffset;
+    quint32 keyLength;   // UTF-16 code units
+    quint32 valueOffset;
+    quint32 valueLength; // bytes
+};
+
+static_assert(std::atomic<quint32>::is_always_lock_free, "seqlock counter must be lock-free to live in shared memory");
+
+// Stable across processes, unlike the seeded qHash
+quint32 keyHash(QStringView key) {
+    quint32 hash = 2166136261u;
+    for (QChar ch : key) {
+        hash = (hash ^ ch.unicode()) * 16777619u;
+    }
+    return hash;
+}
+
+QString fullKey(const QString& group, const QString& key) {
+    return group + '/' + key;
+}
+
+quint32 align8(quint32 size) {
+    return (size + 7u) & ~7u;
+}
+}
+
+SettingsSharedSegment::SettingsSharedSegment(const QString& key)
+    : memory(key)
+    , writerLock(QDir::temp().filePath(QString::fromLatin1(QUrl::toPercentEncoding(key)) + ".writer.lock"))
+{
+}
+
+SettingsSharedSegment::~SettingsSharedSegment() {
+    memory.detach();
+}
+
+bool SettingsSharedSegment::create(int capacity) {
+    error.clear();
+    // QLockFile removes the lock of a writer that died, so only a live one blocks
+    if (!writer && !writerLock.tryLock(0)) {
+        qint64 pid = 0;
+        QString host;
+        QString application;
+        writerLock.getLockInfo(&pid, &host, &application);
+        error = QString("segment %1 is already published by process %2").arg(memory.key()).arg(pid);
+        return false;
+    }
+
+    if (!memory.create(capacity)) {
+        // A previous writer may have left the segment behind after a crash
+        if (memory.error() != QSharedMemory::AlreadyExists || !memory.attach()) {
+            writerLock.unlock();
+            return false;
+        }
+    }
+
+    memory.lock();
+    auto* header = static_cast<SegmentHeader*>(memory.data());
+    header->magic = SegmentMagic;
+    header->layoutVersion = LayoutVersion;
+    header->sequence.store(0, std::memory_order_relaxed);
+    header->capacity = quint32(memory.size());
+    header->entryCount = 0;
+    header->flags = 0;
+    header->generation = 0;
+    memory.unlock();
+
+    writer = true;
+    return true;
+}
+
+bool SettingsSharedSegment::publish(const SettingsCache::Snapshot& values) {
+    if (!writer || !memory.data()) return false;
+
+    struct Record {
+        quint32 hash;
+        QString key;
+        QByteArray value;
+    };
+
+    // Everything is serialized before the segment is touched, keeping the
+    // window in which readers have to retry as short as possible
+    QList<Record> records;
+    for (auto groupIt = values.begin(); groupIt != values.end(); ++groupIt) {
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            Record record;
+            record.key = fullKey(groupIt.key(), keyIt.key());
+            record.hash = keyHash(record.key);
+            QDataStream stream(&record.value, QIODevice::WriteOnly);
+            stream.setVersion(QDataStream::Qt_6_0);
+            stream << keyIt.value();
+            records.append(record);
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.key < b.key;
+    });
+
+    const quint32 entriesOffset = align8(sizeof(SegmentHeader));
+    quint32 dataOffset = align8(entriesOffset + quint32(records.size() * sizeof(SegmentEntry)));
+    QList<SegmentEntry> entries;
+    entries.reserve(records.size());
+    quint64 required = dataOffset;
+    for (const Record& record : std::as_const(records)) {
+        SegmentEntry entry;
+        entry.hash = record.hash;
+        entry.keyOffset = quint32(required);
+        entry.keyLength = quint32(record.key.size());
+        required = align8(quint32(required + record.key.size() * sizeof(QChar)));
+        entry.valueOffset = quint32(required);
+        entry.valueLength = quint32(record.value.size());
+        required = align8(quint32(required + record.value.size()));
+        entries.append(entry);
+    }
+    if (required > quint64(memory.size())) {
+        return false;
+    }
+
+    memory.lock();
+    char* base = static_cast<char*>(memory.data());
+    auto* header = reinterpret_cast<SegmentHeader*>(base);
+
+    const quint32 sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header->entryCount = 0;
+    std::memcpy(base + entriesOffset, entries.constData(), entries.size() * sizeof(SegmentEntry));
+    for (int i = 0; i < records.size(); ++i) {
+        std::memcpy(base + entries[i].keyOffset, records[i].key.constData(), records[i].key.size() * sizeof(QChar));
+        std::memcpy(base + entries[i].valueOffset, records[i].value.constData(), records[i].value.size());
+    }
+    header->entryCount = quint32(entries.size());
+    header->flags &= ~StaleFlag;
+    ++header->generation;
+
+    header->sequence.store(sequence + 2, std::memory_order_release);
+    memory.unlock();
+    return true;
+}
+
+void SettingsSharedSegment::invalidate() {
+    if (!writer || !memory.data()) return;
+
+    memory.lock();
+    auto* header = static_cast<SegmentHeader*>(memory.data());
+    const quint32 sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header->entryCount = 0;
+    header->flags |= StaleFlag;
+    ++header->generation;
+
+    header->sequence.store(sequence + 2, std::memory_order_release);
+    memory.unlock();
+}
+
+bool SettingsSharedSegment::attach() {
+    if (!memory.attach(QSharedMemory::ReadOnly)) return false;
+
+    const auto* header = static_cast<const SegmentHeader*>(memory.constData());
+    if (memory.size() < int(sizeof(SegmentHeader))
+        || header->magic != SegmentMagic || header->layoutVersion != LayoutVersion) {
+        memory.detach();
+        return false;
+    }
+    return true;
+}
+
+bool SettingsSharedSegment::lookup(const QString& group, const QString& key, QByteArray* value) const {
+    const char* base = static_cast<const char*>(memory.constData());
+    if (!base) return false;
+
+    const auto* header = reinterpret_cast<const SegmentHeader*>(base);
+    const QString wanted = fullKey(group, key);
+    const quint32 hash = keyHash(wanted);
+    const quint32 size = quint32(memory.size());
+    const quint32 entriesOffset = align8(sizeof(SegmentHeader));
+    const quint32 maxEntries = (size - entriesOffset) / sizeof(SegmentEntry);
+
+    for (int attempt = 0; attempt < MaxReadAttempts; ++attempt) {
+        const quint32 before = header->sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        // Fields may be torn by a concurrent publish; every offset is bounds
+        // checked and the result is only trusted if the sequence did not move
+        const quint32 count = std::min(header->entryCount, maxEntries);
+        auto entryAt = [&](quint32 index) {
+            SegmentEntry entry;
+            std::memcpy(&entry, base + entriesOffset + index * sizeof(SegmentEntry), sizeof(SegmentEntry));
+            return entry;
+        };
+
+        quint32 low = 0;
+        quint32 high = count;
+        while (low < high) {
+            const quint32 mid = low + (high - low) / 2;
+            if (entryAt(mid).hash < hash) low = mid + 1;
+            else high = mid;
+        }
+
+        bool found = false;
+        QByteArray bytes;
+        for (quint32 index = low; index < count; ++index) {
+            const SegmentEntry entry = entryAt(index);
+            if (entry.hash != hash) break;
+            if (entry.keyLength != quint32(wanted.size())) continue;
+            if (quint64(entry.keyOffset) + entry.keyLength * sizeof(QChar) > size
+                || quint64(entry.valueOffset) + entry.valueLength > size) break;
+            if (std::memcmp(base + entry.keyOffset, wanted.constData(), entry.keyLength * sizeof(QChar)) != 0) continue;
+
+            bytes = QByteArray(base + entry.valueOffset, entry.valueLength);
+            found = true;
+            break;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) != before) continue;
+
+        if (found && value) *value = bytes;
+        return found;
+    }
+    return false;
+}
+
+QVariant SettingsSharedSegment::value(const QString& group, const QString& key, const QVariant& defaultValue) const {
+    QByteArray bytes;
+    if (!lookup(group, key, &bytes)) return defaultValue;
+
+    QVariant value;
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream >> value;
+    return stream.status() == QDataStream::Ok ? value : defaultValue;
+}
+
+bool SettingsSharedSegment::contains(const QString& group, const QString& key) const {
+    return lookup(group, key, nullptr);
+}
+
+quint64 SettingsSharedSegment::generation() const {
+    const char* base = static_cast<const char*>(memory.constData());
+    if (!base) return 0;
+    const auto* header = reinterpret_cast<const SegmentHeader*>(base);
+
+    for (int attempt = 0; attempt < MaxReadAttempts; ++attempt) {
+        const quint32 before = header->sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        const quint64 generation = header->generation;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) == before) return generation;
+    }
+    return 0;
+}
+
+bool SettingsSharedSegment::isStale() const {
+    const char* base = static_cast<const char*>(memory.constData());
+    if (!base) return false;
+    const auto* header = reinterpret_cast<const SegmentHeader*>(base);
+
+    for (int attempt = 0; attempt < MaxReadAttempts; ++attempt) {
+        const quint32 before = header->sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        const quint32 flags = header->flags;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) == before) return flags & StaleFlag;
+    }
+    return false;
+}
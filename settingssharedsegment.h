@@ -0,0 +1,50 @@
+#ifndef SETTINGSSHAREDSEGMENT_H
+#define SETTINGSSHAREDSEGMENT_H
+
+#include "settingscache.h"
+#include <QLockFile>
+#include <QSharedMemory>
+
+// Read-mostly shared-memory copy of the persisted settings for processes on
+// the same host. One writer publishes a flat, hash-sorted table of
+// "group/key" -> serialized value; readers map the segment and look values up
+// in place, without loading or parsing the store. A sequence counter (seqlock)
+// lets readers detect and retry reads that overlapped a publish, so they never
+// take a lock. A lock file in the temporary directory names the writer, so a
+// second writer is refused while the first is alive.
+class SettingsSharedSegment
+{
+public:
+    static const int DefaultCapacity = 4 * 1024 * 1024;
+
+    explicit SettingsSharedSegment(const QString& key = QStringLiteral("TestLabs.TestSettings"));
+    ~SettingsSharedSegment();
+
+    // Writer side: creates the segment, or takes over one left by a writer that
+    // has exited; fails while another writer is running
+    bool create(int capacity = DefaultCapacity);
+    bool publish(const SettingsCache::Snapshot& values);
+    // Empties the segment and marks it stale, e.g. when the values no longer
+    // fit; lookups fail until the next successful publish
+    void invalidate();
+
+    // Reader side
+    bool attach();
+    QVariant value(const QString& group, const QString& key, const QVariant& defaultValue = QVariant()) const;
+    bool contains(const QString& group, const QString& key) const;
+    // Increments with every publish or invalidate(); lets readers notice that something changed
+    quint64 generation() const;
+    bool isStale() const;
+
+    QString errorString() const { return error.isEmpty() ? memory.errorString() : error; }
+
+private:
+    bool lookup(const QString& group, const QString& key, QByteArray* value) const;
+
+    mutable QSharedMemory memory;
+    QLockFile writerLock;
+    QString error;
+    bool writer = false;
+};
+
+#endif // SETTINGSSHAREDSEGMENT_H
@@ -0,0 +1,87 @@
+#include "settingsstringpool.h"
+#include <QReadWriteLock>
+#include <QSet>
+#include <atomic>
+
+namespace {
+// Shards keep threads interning unrelated strings off each other's lock
+const int ShardCount = 16;
+// Per string: the QArrayData header, the terminating null and a QSet node
+// (the QString itself plus the span's offset byte, rounded up)
+const qint64 StringOverhead = qint64(sizeof(QArrayData)) + qint64(sizeof(QChar)) + qint64(sizeof(QString)) + 8;
+
+struct Shard {
+    QReadWriteLock lock;
+    QSet<QString> strings;
+    qint64 bytes = 0;
+};
+
+struct Pool {
+    Shard shards[ShardCount];
+    std::atomic<quint64> lookups{0};
+    std::atomic<quint64> hits{0};
+};
+
+Pool& pool() {
+    static Pool instance;
+    return instance;
+}
+
+Shard& shardFor(const QString& text) {
+    return pool().shards[qHash(text) % ShardCount];
+}
+}
+
+QString SettingsStringPool::intern(const QString& text) {
+    if (text.isEmpty()) return QString();
+
+    Pool& strings = pool();
+    strings.lookups.fetch_add(1, std::memory_order_relaxed);
+    Shard& shard = shardFor(text);
+    {
+        QReadLocker locker(&shard.lock);
+        auto it = shard.strings.constFind(text);
+        if (it != shard.strings.constEnd()) {
+            strings.hits.fetch_add(1, std::memory_order_relaxed);
+            return *it;
+        }
+    }
+
+    QWriteLocker locker(&shard.lock);
+    auto it = shard.strings.constFind(text);
+    if (it != shard.strings.constEnd()) {
+        strings.hits.fetch_add(1, std::memory_order_relaxed);
+        return *it;
+    }
+    // Exactly sized copy; `text` may have spare capacity or wrap raw data
+    const QString stored(text.constData(), text.size());
+    shard.strings.insert(stored);
+    shard.bytes += stored.size() * qint64(sizeof(QChar)) + StringOverhead;
+    return stored;
+}
+
+QString SettingsStringPool::shared(const QString& text) {
+    if (text.isEmpty()) return QString();
+
+    Pool& strings = pool();
+    strings.lookups.fetch_add(1, std::memory_order_relaxed);
+    Shard& shard = shardFor(text);
+    QReadLocker locker(&shard.lock);
+    auto it = shard.strings.constFind(text);
+    if (it == shard.strings.constEnd()) return text;
+    strings.hits.fetch_add(1, std::memory_order_relaxed);
+    return *it;
+}
+
+SettingsStringPool::Stats SettingsStringPool::stats() {
+    Pool& strings = pool();
+    Stats result;
+    for (Shard& shard : strings.shards) {
+        QReadLocker locker(&shard.lock);
+        result.strings += int(shard.strings.size());
+        result.bytes += shard.bytes;
+    }
+    result.lookups = strings.lookups.load(std::memory_order_relaxed);
+    result.hits = strings.hits.load(std::memory_order_relaxed);
+    return result;
+}
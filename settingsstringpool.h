@@ -0,0 +1,37 @@
+#ifndef SETTINGSSTRINGPOOL_H
+#define SETTINGSSTRINGPOOL_H
+
+#include <QString>
+
+// Process-wide table of interned strings. Only the schema interns: SettingsItem
+// ids, which are also the group names and keys in the stores. The cache, the
+// backends and the journal look their group and key strings up with shared(),
+// which reuses the schema's copy but never adds to the table, so keys set by
+// IPC clients or found in a store cannot grow it. Interned strings stay in the
+// table until the process exits; it is bounded by the schemas loaded.
+//
+// This only saves memory. Keys are still plain QStrings: cache lookups hash
+// and compare them in full, and shared() itself costs a hash and a shard lock,
+// so callers only use it when they add a key they will keep. Handles that carry
+// a precomputed hash were not adopted, because every map in the cache and the
+// backends would have to change its key type. Hot paths that need integer keys
+// use the slots instead (SettingsCache::setSlots(), settingsgen).
+class SettingsStringPool
+{
+public:
+    struct Stats {
+        int strings = 0;
+        // Estimated heap used by the table: string data, headers and set nodes
+        qint64 bytes = 0;
+        quint64 lookups = 0;
+        // Lookups that found the string already interned
+        quint64 hits = 0;
+    };
+
+    static QString intern(const QString& text);
+    // The interned copy of `text` if there is one, otherwise `text` itself
+    static QString shared(const QString& text);
+    static Stats stats();
+};
+
+#endif // SETTINGSSTRINGPOOL_H
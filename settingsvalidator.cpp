@@ -0,0 +1,151 @@
+#include "settingsvalidator.h"
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <optional>
+
+struct SettingsValidator::Rules {
+    std::optional<double> min;
+    std::optional<double> max;
+    std::optional<int> minLength;
+    std::optional<int> maxLength;
+    QRegularExpression pattern;
+    bool hasPattern = false;
+    QSet<QString> allowed;
+    QString checkName;
+    Predicate check;
+};
+
+namespace {
+bool isColor(const QVariant& value, QString* message) {
+    // The forms QColor::name() produces and QColor accepts: #rgb, #rrggbb, #aarrggbb
+    static const QRegularExpression hex("^#([0-9A-Fa-f]{3}|[0-9A-Fa-f]{6}|[0-9A-Fa-f]{8})$");
+    if (hex.match(value.toString()).hasMatch()) return true;
+    if (message) *message = "expected a color such as #0078d4";
+    return false;
+}
+
+bool isGlob(const QVariant& value, QString* message) {
+    const QString text = value.toString();
+    if (!text.isEmpty() && !text.contains('/') && !text.contains('\\')
+        && QRegularExpression::fromWildcard(text).isValid()) {
+        return true;
+    }
+    if (message) *message = "expected a file name pattern such as *.png";
+    return false;
+}
+
+bool isPath(const QVariant& value, QString* message) {
+    const QString text = value.toString();
+    static const QRegularExpression invalid(R"([<>"|?*\x00-\x1f])");
+    if (!text.isEmpty() && !invalid.match(text).hasMatch()) {
+        return true;
+    }
+    if (message) *message = "expected a file system path";
+    return false;
+}
+
+QHash<QString, SettingsValidator::Predicate>& predicates() {
+    static QHash<QString, SettingsValidator::Predicate> registry{
+        {"color", isColor},
+        {"glob", isGlob},
+        {"path", isPath}
+    };
+    return registry;
+}
+
+std::optional<double> number(const QVariantMap& constraints, const char* name, bool* ok) {
+    if (!constraints.contains(name)) return std::nullopt;
+    bool valid = false;
+    const double value = constraints.value(name).toDouble(&valid);
+    if (!valid) *ok = false;
+    return value;
+}
+}
+
+SettingsValidator SettingsValidator::compile(const QVariantMap& constraints, QString* error) {
+    SettingsValidator validator;
+    if (constraints.isEmpty()) return validator;
+
+    auto rules = QSharedPointer<Rules>::create();
+    bool ok = true;
+    rules->min = number(constraints, "min", &ok);
+    rules->max = number(constraints, "max", &ok);
+    if (auto length = number(constraints, "minLength", &ok)) rules->minLength = int(*length);
+    if (auto length = number(constraints, "maxLength", &ok)) rules->maxLength = int(*length);
+    if (!ok) {
+        if (error) *error = "range and length limits must be numbers";
+        return validator;
+    }
+
+    if (constraints.contains("pattern")) {
+        rules->pattern.setPattern(QRegularExpression::anchoredPattern(constraints.value("pattern").toString()));
+        if (!rules->pattern.isValid()) {
+            if (error) *error = QString("invalid pattern: %1").arg(rules->pattern.errorString());
+            return validator;
+        }
+        rules->pattern.optimize();
+        rules->hasPattern = true;
+    }
+
+    const QVariantList allowed = constraints.value("enum").toList();
+    for (const QVariant& value : allowed) {
+        rules->allowed.insert(value.toString());
+    }
+
+    if (constraints.contains("check")) {
+        rules->checkName = constraints.value("check").toString();
+        rules->check = predicates().value(rules->checkName);
+        if (!rules->check) {
+            if (error) *error = QString("unknown check '%1'").arg(rules->checkName);
+            return validator;
+        }
+    }
+
+    validator.rules = rules;
+    return validator;
+}
+
+void SettingsValidator::registerPredicate(const QString& name, Predicate predicate) {
+    predicates().insert(name, std::move(predicate));
+}
+
+bool SettingsValidator::validate(const QVariant& value, QString* message) const {
+    if (!rules) return true;
+
+    if (rules->min || rules->max) {
+        bool numeric = false;
+        const double number = value.toDouble(&numeric);
+        if (!numeric) {
+            if (message) *message = "expected a number";
+            return false;
+        }
+        if ((rules->min && number < *rules->min) || (rules->max && number > *rules->max)) {
+            if (message) {
+                *message = QString("expected a value between %1 and %2")
+                               .arg(rules->min ? QString::number(*rules->min) : QString("-inf"),
+                                    rules->max ? QString::number(*rules->max) : QString("inf"));
+            }
+            return false;
+        }
+    }
+
+    const QString text = value.toString();
+    if ((rules->minLength && text.size() < *rules->minLength)
+        || (rules->maxLength && text.size() > *rules->maxLength)) {
+        if (message) *message = "value has the wrong length";
+        return false;
+    }
+
+    if (rules->hasPattern && !rules->pattern.match(text).hasMatch()) {
+        if (message) *message = QString("does not match %1").arg(rules->pattern.pattern());
+        return false;
+    }
+
+    if (!rules->allowed.isEmpty() && !rules->allowed.contains(text)) {
+        if (message) *message = "not one of the allowed values";
+        return false;
+    }
+
+    return !rules->check || rules->check(value, message);
+}
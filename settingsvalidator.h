@@ -0,0 +1,38 @@
+#ifndef SETTINGSVALIDATOR_H
+#define SETTINGSVALIDATOR_H
+
+#include <QSharedPointer>
+#include <QVariantMap>
+#include <functional>
+
+// Constraints of one setting, compiled once into a validator. Copies share the
+// compiled rules and validate() is const, so one validator can be used from
+// many threads at the same time.
+//
+//   min, max               numeric range
+//   minLength, maxLength   string length
+//   pattern                regular expression the whole value has to match
+//   enum                   list of allowed values
+//   check                  name of a registered predicate: "color", "glob", "path"
+class SettingsValidator
+{
+public:
+    // Sets *message when the value is rejected
+    using Predicate = std::function<bool(const QVariant& value, QString* message)>;
+
+    // A default-constructed validator accepts everything
+    SettingsValidator() = default;
+
+    static SettingsValidator compile(const QVariantMap& constraints, QString* error = nullptr);
+    // Makes `name` available to "check"; not thread-safe, register at startup
+    static void registerPredicate(const QString& name, Predicate predicate);
+
+    bool isNull() const { return !rules; }
+    bool validate(const QVariant& value, QString* message = nullptr) const;
+
+private:
+    struct Rules;
+    QSharedPointer<const Rules> rules;
+};
+
+#endif // SETTINGSVALIDATOR_H
@@ -1,14 +1,12 @@
 #include "settingswidgetbuilder.h"
 #include "settingsitem.h"
+#include "settingsitemwidget.h"
+#include "settingsmetrics.h"
 #include <QVBoxLayout>
 #include <QTreeWidget>
 #include <QStackedWidget>
 #include <QScrollArea>
-#include <QLineEdit>
 #include <QSettings>
-#include <QComboBox>
-#include <QCheckBox>
-#include <QSpinBox>
 #include <QLabel>
 #include <QDebug>
 #include <QFile>
@@ -73,7 +71,7 @@ void SettingsWidgetBuilder::resetAllSettings() {
 
             for (SettingsItem* setting : allItems) {
                 if (!setting->isGroup()) {
-                    setting->resetToDefault();
+                    SettingsItemWidget::resetToDefault(setting);
                 }
             }
         }
@@ -139,7 +137,7 @@ void SettingsWidgetBuilder::createGroupPage(QStackedWidget* stackedWidget, Setti
     for (int i = 0; i < groupItem->childCount(); ++i) {
         SettingsItem* child = groupItem->child(i);
         if (!child->isGroup()) {
-            QHBoxLayout* itemLayout = child->createWidget();
+            QHBoxLayout* itemLayout = SettingsItemWidget::create(child);
             if (itemLayout) {
                 layout->addLayout(itemLayout);
             }
@@ -200,7 +198,7 @@ void SettingsWidgetBuilder::saveSettings() {
     for (SettingsItem* item : std::as_const(widgetList_)) {
         if (!item->isSavingEnabled() || item->isGroup()) continue;
 
-        QVariant value = item->getValue();
+        QVariant value = SettingsItemWidget::value(item);
         settings.setValue(item->id(), value);
     }
 
@@ -208,74 +206,17 @@ void SettingsWidgetBuilder::saveSettings() {
 }
 
 void SettingsWidgetBuilder::applyValueToWidget(SettingsItem* item, const QVariant& value) {
-    if (QComboBox* comboBox = item->comboBox()) {
-        QString text = value.toString();
-        int index = comboBox->findText(text);
-        if (index >= 0) {
-            comboBox->setCurrentIndex(index);
-        }
-    }
-    else if (QCheckBox* checkBox = item->checkBox()) {
-        bool checked = value.toBool();
-        checkBox->setChecked(checked);
-    }
-    else if (QSpinBox* spinBox = item->spinBox()) {
-        int val = value.toInt();
-        spinBox->setValue(val);
-    }
-    else if (QLineEdit* lineEdit = qobject_cast<QLineEdit*>(item->controlWidget())) {
-        QString text = value.toString();
-        lineEdit->setText(text);
-    }
-    else if (QWidget* compositeWidget = item->controlWidget()) {
-        QLineEdit* lineEdit = compositeWidget->findChild<QLineEdit*>();
-        if (lineEdit) {
-            QString text = value.toString();
-            lineEdit->setText(text);
-        }
-    }
+    SettingsItemWidget::setValue(item, value);
 }
 
 void SettingsWidgetBuilder::connectSignalsForAutoSave() {
     for (SettingsItem* item : std::as_const(widgetList_)) {
         if (!item->isSavingEnabled() || item->isGroup()) continue;
 
-        QWidget* control = item->controlWidget();
-        if (!control) continue;
-
-        if (auto* combo = qobject_cast<QComboBox*>(control)) {
-            connect(combo, QOverload<int>::of(&QComboBox::currentIndexChanged),
-                   [this]() {
-                       this->saveSettings();
-                   });
-        }
-        else if (auto* check = qobject_cast<QCheckBox*>(control)) {
-            connect(check, &QCheckBox::toggled,
-                   [this]() {
-                       this->saveSettings();
-                   });
-        }
-        else if (auto* spin = qobject_cast<QSpinBox*>(control)) {
-            connect(spin, QOverload<int>::of(&QSpinBox::valueChanged),
-                   [this]() {
-                       this->saveSettings();
-                   });
-        }
-        else if (auto* lineEdit = qobject_cast<QLineEdit*>(control)) {
-            connect(lineEdit, &QLineEdit::textChanged,
-                   [this]() {
-                       this->saveSettings();
-                   });
-        }
-        else {
-            QLineEdit* innerLineEdit = control->findChild<QLineEdit*>();
-            if (innerLineEdit) {
-                connect(innerLineEdit, &QLineEdit::textChanged,
-                       [this]() {
-                           this->saveSettings();
-                       });
-            }
-        }
+        SettingsItemWidget::connectValueChanged(item, this, [this]() {
+            SettingsMetrics::add(SettingsMetrics::AutoSaves);
+            this->saveSettings();
+        });
     }
 }
 
@@ -289,7 +230,7 @@ SettingsWidgetBuilder::~SettingsWidgetBuilder() {
     for (SettingsItem* item : std::as_const(widgetList_)) {
         if (!item->isSavingEnabled() || item->isGroup()) continue;
 
-        settings.setValue(item->id(), item->getValue());
+        settings.setValue(item->id(), SettingsItemWidget::value(item));
     }
 
     settings.sync();
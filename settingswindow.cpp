@@ -1,12 +1,12 @@
 #include "settingswindow.h"
+#include "boundedsettingscache.h"
 #include "settingsitem.h"
-#include "comboboxfactory.h"
-#include "spinboxfactory.h"
-#include "checkboxfactory.h"
-#include "lineeditfactory.h"
-#include "pushbuttonfactory.h"
-#include "filebrowsefactory.h"
-#include "colordialogfactory.h"
+#include "settingsitemwidget.h"
+#include "settingsschemaloader.h"
+#include "settingsfactorypool.h"
+#include "settingsprofile.h"
+#include "settingsmetrics.h"
+#include "settingsstringpool.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -18,23 +18,41 @@
 #include <QTreeWidgetItem>
 #include <QCloseEvent>
 #include <QPushButton>
-#include <QSettings>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QFile>
+#include <QSaveFile>
+#include <QSettings>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QTimer>
 #include <QDebug>
-#include <QComboBox>
-#include <QCheckBox>
-#include <QSpinBox>
-#include <QLineEdit>
+
+namespace {
+// Compiled into the application (see CMakeLists.txt)
+const char* SchemaFileName = ":/settings.json";
+const char* ProfileFilter = "Settings profiles (*.jsonl *.scp);;JSON Lines (*.jsonl);;Binary profile (*.scp)";
+const int DiagnosticsRefreshMs = 1000;
+// Where releases before the settings cache kept values, as root keys named by item id
+const char* LegacyOrganization = "TestLabs";
+const char* LegacyApplication = "TestSettings";
+
+QVariant currentValue(const SettingsItem* item) {
+    return SettingsCache::instance().getValue(item->groupId(), item->id(), item->defaultValue());
+}
+}
 
 SettingsWindow::SettingsWindow(QWidget* parent) : QWidget(parent) {
     setupUI();
     createSettingsTree();
     setupConnections();
     loadSettings();
-    connectSignalsForAutoSave();
+    connectSignalsForSession();
 }
 
 SettingsWindow::~SettingsWindow() {
+    // Controls must go before the items whose factories they were created from
+    qDeleteAll(groupPages);
     delete rootItem;
 }
 
@@ -47,8 +65,18 @@ void SettingsWindow::setupUI() {
     resetGroupButton = new QPushButton("Reset Current Group");
     buttonLayout->addWidget(resetAllButton);
     buttonLayout->addWidget(resetGroupButton);
+
+    importButton = new QPushButton("Import...");
+    exportButton = new QPushButton("Export...");
+    buttonLayout->addWidget(importButton);
+    buttonLayout->addWidget(exportButton);
     buttonLayout->addStretch();
 
+    applyButton = new QPushButton("Apply");
+    cancelButton = new QPushButton("Cancel");
+    buttonLayout->addWidget(applyButton);
+    buttonLayout->addWidget(cancelButton);
+
     QHBoxLayout* contentLayout = new QHBoxLayout();
     treeWidget = new QTreeWidget();
     treeWidget->setFixedWidth(250);
@@ -67,49 +95,43 @@ void SettingsWindow::setupUI() {
 }
 
 void SettingsWindow::createSettingsTree() {
-    rootItem = new SettingsItem("root", "Settings", "Application Settings", QVariant(), nullptr, nullptr, false);
-
-    SettingsItem* mainGroup = new SettingsItem("main_group", "Main Settings", "General application settings", rootItem);
-    SettingsItem* templateGroup = new SettingsItem("template_group", "Template Settings", "File template settings", rootItem);
-    SettingsItem* colorGroup = new SettingsItem("appearance_group", "Appearance", "Visual appearance settings", rootItem);
-
-    // Language
-    auto* languageItem = new SettingsItem("1", "Language", "Select interface language",
-                                          "English", mainGroup,
-                                          new ComboBoxFactory({"English", "Russian", "Spanish"}), true);
-
-    // Autostart
-    auto* autostartItem = new SettingsItem("2", "Autostart", "Run application on system startup",
-                                           true, mainGroup,
-                                           new CheckBoxFactory(), true);
-
-    // Timeout
-    auto* timeoutItem = new SettingsItem("3", "Timeout", "Request timeout in milliseconds",
-                                         300, mainGroup,
-                                         new SpinBoxFactory(100, 10000), true);
-
-    // File Template
-    auto* fileTemplateItem = new SettingsItem("4", "File Template", "Template for file searching",
-                                              "*.png", templateGroup,
-                                              new LineEditFactory(), true);
-
-    // Storage Path
-    auto* storageItem = new SettingsItem("5", "Storage Path", "Location where files will be stored",
-                                         "D:/storage", templateGroup,
-                                         new FileBrowseFactory(new LineEditFactory(), new PushButtonFactory("Browse...")), true);
-
-    // Theme Color
-    auto* themeItem = new SettingsItem("6", "Theme Color", "Choose application theme color",
-                                       "#0078d4", colorGroup,
-                                       new ColorDialogFactory(new LineEditFactory(), new PushButtonFactory("Choose Color")), true);
-
-    // Font Size
-    auto* fontSizeItem = new SettingsItem("7", "Font Size", "Application font size",
-                                          12, colorGroup,
-                                          new SpinBoxFactory(8, 24), true);
+    SettingsFactoryPool factories;
+    SettingsSchemaLoader loader([&factories](const QString& control, const QVariantMap& options) {
+        return factories.factory(control, options);
+    });
+
+    rootItem = loader.load(SchemaFileName);
+    if (!rootItem) {
+        qWarning() << "Failed to load settings schema:" << loader.errorString();
+        rootItem = new SettingsItem("root", "Settings", "Application Settings");
+    }
+
+    for (SettingsItem* item : rootItem->getAllChildren()) {
+        if (!item->isGroup()) {
+            itemsById.insert(item->id(), item);
+        }
+    }
+    if (!dependencies.build(rootItem)) {
+        qWarning() << "Ignoring settings rules:" << dependencies.errorString();
+    }
+
+    SettingsCache& cache = SettingsCache::instance();
+    for (SettingsItem* item : std::as_const(itemsById)) {
+        if (item->constraints().isEmpty()) continue;
+        QString error;
+        const SettingsValidator validator = SettingsValidator::compile(item->constraints(), &error);
+        if (!error.isEmpty()) {
+            qWarning() << "Ignoring constraints of" << item->id() << ":" << error;
+            continue;
+        }
+        cache.setValidator(item->groupId(), item->id(), validator);
+    }
 
     buildTreeWidget();
     createPagesForGroups();
+    if (SettingsMetrics::isEnabled()) {
+        createDiagnosticsPage();
+    }
 }
 
 void SettingsWindow::buildTreeWidget() {
@@ -143,6 +165,8 @@ void SettingsWindow::createPagesForGroups() {
 }
 
 void SettingsWindow::createPageForGroup(SettingsItem* group) {
+    SettingsMetrics::ScopedTimer timer(SettingsMetrics::PageBuildTime);
+
     auto* scroll = new QScrollArea();
     scroll->setWidgetResizable(true);
     scroll->setFrameShape(QFrame::NoFrame);
@@ -169,7 +193,7 @@ void SettingsWindow::createPageForGroup(SettingsItem* group) {
     for (int i = 0; i < group->childCount(); ++i) {
         SettingsItem* child = group->child(i);
         if (!child->isGroup()) {
-            QHBoxLayout* row = child->createWidget();
+            QHBoxLayout* row = SettingsItemWidget::create(child);
             if (row) {
                 if (hasSettings) {
                     auto* sep = new QFrame();
@@ -178,6 +202,7 @@ void SettingsWindow::createPageForGroup(SettingsItem* group) {
                     layout->addWidget(sep);
                 }
                 layout->addLayout(row);
+                rowsByItem.insert(child, row);
                 hasSettings = true;
             }
         }
@@ -196,14 +221,140 @@ void SettingsWindow::createPageForGroup(SettingsItem* group) {
     stackedWidget->addWidget(scroll);
 }
 
+void SettingsWindow::createDiagnosticsPage() {
+    auto* content = new QWidget();
+    auto* layout = new QVBoxLayout(content);
+    layout->setContentsMargins(25, 25, 25, 25);
+
+    auto* title = new QLabel("Diagnostics");
+    QFont f = title->font();
+    f.setPointSize(16);
+    f.setBold(true);
+    title->setFont(f);
+    layout->addWidget(title);
+
+    diagnosticsTable = new QTableWidget(0, 6);
+    diagnosticsTable->setHorizontalHeaderLabels({"Metric", "Count", "Mean", "p50", "p99", "Max"});
+    diagnosticsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    diagnosticsTable->verticalHeader()->hide();
+    diagnosticsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(diagnosticsTable, 1);
+
+    filterLabel = new QLabel();
+    layout->addWidget(filterLabel);
+    poolLabel = new QLabel();
+    layout->addWidget(poolLabel);
+
+    layout->addWidget(new QLabel("Cache lock by call site"));
+    lockTable = new QTableWidget(0, 8);
+    lockTable->setHorizontalHeaderLabels({"Site", "Mode", "Count", "Contended", "Wait", "Max wait", "Hold", "Max hold"});
+    lockTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    lockTable->verticalHeader()->hide();
+    lockTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(lockTable, 1);
+
+    auto* resetButton = new QPushButton("Reset Counters");
+    connect(resetButton, &QPushButton::clicked, this, [this]() {
+        SettingsMetrics::reset();
+        SettingsCache::instance().resetLockProfile();
+        refreshDiagnostics();
+    });
+    layout->addWidget(resetButton, 0, Qt::AlignLeft);
+
+    diagnosticsPage = content;
+    stackedWidget->addWidget(diagnosticsPage);
+
+    diagnosticsTreeItem = new QTreeWidgetItem(treeWidget);
+    diagnosticsTreeItem->setText(0, "Diagnostics");
+
+    // Refreshed only while the page is shown
+    diagnosticsTimer = new QTimer(this);
+    diagnosticsTimer->setInterval(DiagnosticsRefreshMs);
+    connect(diagnosticsTimer, &QTimer::timeout, this, [this]() {
+        if (stackedWidget->currentWidget() == diagnosticsPage) refreshDiagnostics();
+    });
+    diagnosticsTimer->start();
+}
+
+void SettingsWindow::refreshDiagnostics() {
+    const SettingsMetrics::Report report = SettingsMetrics::report();
+    auto duration = [](qint64 ns) {
+        if (ns < 10000) return QString("%1 ns").arg(ns);
+        if (ns < 10000000) return QString("%1 us").arg(ns / 1000);
+        return QString("%1 ms").arg(ns / 1000000);
+    };
+
+    diagnosticsTable->setRowCount(SettingsMetrics::CounterCount + SettingsMetrics::TimerCount);
+    QTableWidget* table = diagnosticsTable;
+    int row = 0;
+    auto setRow = [&table, &row](const QStringList& cells) {
+        for (int column = 0; column < cells.size(); ++column) {
+            table->setItem(row, column, new QTableWidgetItem(cells[column]));
+        }
+        ++row;
+    };
+
+    for (int i = 0; i < SettingsMetrics::CounterCount; ++i) {
+        setRow({SettingsMetrics::name(SettingsMetrics::Counter(i)), QString::number(report.counters[i]),
+                QString(), QString(), QString(), QString()});
+    }
+    for (int i = 0; i < SettingsMetrics::TimerCount; ++i) {
+        const SettingsMetrics::Histogram& histogram = report.timers[i];
+        setRow({QString(SettingsMetrics::name(SettingsMetrics::Timer(i))) + " time", QString::number(histogram.count),
+                duration(histogram.meanNs()), duration(histogram.percentileNs(0.5)),
+                duration(histogram.percentileNs(0.99)), duration(qint64(histogram.maxNs))});
+    }
+
+    // Observed rate: lookups the filters let through that still missed, out of all misses they saw
+    const BoundedSettingsCache::FilterTotals filters = BoundedSettingsCache::filterTotals();
+    const quint64 rejects = report.counters[SettingsMetrics::FilterRejects];
+    const quint64 falsePositives = report.counters[SettingsMetrics::FilterFalsePositives];
+    const double observedRate = rejects + falsePositives ? double(falsePositives) / double(rejects + falsePositives) : 0.0;
+    // Each filter is sized for its group's keys, at about 1% false positives
+    filterLabel->setText(QString("Key filters of evicted groups: %1 filters, %2 KiB; %3 rejects, %4 false positives (%5%, sized for 1%)")
+                             .arg(filters.filters)
+                             .arg(double(filters.bytes) / 1024.0, 0, 'f', 1)
+                             .arg(rejects)
+                             .arg(falsePositives)
+                             .arg(observedRate * 100.0, 0, 'f', 2));
+
+    const SettingsStringPool::Stats strings = SettingsStringPool::stats();
+    poolLabel->setText(QString("Interned strings: %1, %2 KiB; %3 of %4 lookups shared an existing string")
+                           .arg(strings.strings)
+                           .arg(double(strings.bytes) / 1024.0, 0, 'f', 1)
+                           .arg(strings.hits)
+                           .arg(strings.lookups));
+
+    const QList<SettingsLock::SiteProfile> sites = SettingsCache::instance().lockProfile();
+    lockTable->setRowCount(sites.size());
+    table = lockTable;
+    row = 0;
+    for (const SettingsLock::SiteProfile& site : sites) {
+        setRow({QString::fromLatin1(site.site), site.mode == SettingsLock::Read ? "read" : "write",
+                QString::number(site.acquisitions), QString::number(site.contended),
+                duration(qint64(site.waitNs)), duration(qint64(site.maxWaitNs)),
+                duration(qint64(site.holdNs)), duration(qint64(site.maxHoldNs))});
+    }
+}
+
 void SettingsWindow::setupConnections() {
     connect(treeWidget, &QTreeWidget::currentItemChanged, this, &SettingsWindow::onTreeItemChanged);
     connect(resetAllButton, &QPushButton::clicked, this, &SettingsWindow::onResetAllClicked);
     connect(resetGroupButton, &QPushButton::clicked, this, &SettingsWindow::onResetGroupClicked);
+    connect(applyButton, &QPushButton::clicked, this, &SettingsWindow::onApplyClicked);
+    connect(cancelButton, &QPushButton::clicked, this, &SettingsWindow::onCancelClicked);
+    connect(importButton, &QPushButton::clicked, this, &SettingsWindow::onImportClicked);
+    connect(exportButton, &QPushButton::clicked, this, &SettingsWindow::onExportClicked);
+    connect(&SettingsCache::instance(), &SettingsCache::externalChanges, this, &SettingsWindow::onExternalChanges);
 }
 
 void SettingsWindow::onTreeItemChanged(QTreeWidgetItem* current, QTreeWidgetItem*) {
     if (!current) return;
+    if (current == diagnosticsTreeItem) {
+        refreshDiagnostics();
+        stackedWidget->setCurrentWidget(diagnosticsPage);
+        return;
+    }
     auto* item = current->data(0, Qt::UserRole).value<SettingsItem*>();
     if (item && item->isGroup() && groupPages.contains(item)) {
         stackedWidget->setCurrentWidget(groupPages[item]);
@@ -215,11 +366,10 @@ void SettingsWindow::onResetAllClicked() {
                               QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
         for (SettingsItem* item : rootItem->getAllChildren()) {
             if (!item->isGroup() && item->isSavingEnabled()) {
-                item->resetToDefault();
+                SettingsItemWidget::resetToDefault(item);
             }
         }
-        saveSettings();
-        QMessageBox::information(this, "Reset", "All settings reset to default.");
+        QMessageBox::information(this, "Reset", "All settings reset to default. Press Apply to keep the changes.");
     }
 }
 
@@ -241,72 +391,278 @@ void SettingsWindow::onResetGroupClicked() {
         for (int i = 0; i < group->childCount(); ++i) {
             auto* child = group->child(i);
             if (!child->isGroup() && child->isSavingEnabled()) {
-                child->resetToDefault();
+                SettingsItemWidget::resetToDefault(child);
             }
         }
-        saveSettings();
-        QMessageBox::information(this, "Reset", QString("'%1' group reset to default.").arg(group->name()));
+        QMessageBox::information(this, "Reset", QString("'%1' group reset to default. Press Apply to keep the changes.").arg(group->name()));
+    }
+}
+
+void SettingsWindow::onApplyClicked() {
+    applySession();
+}
+
+void SettingsWindow::onCancelClicked() {
+    cancelSession();
+}
+
+void SettingsWindow::onImportClicked() {
+    const QString fileName = QFileDialog::getOpenFileName(this, "Import Settings", QString(), ProfileFilter);
+    if (fileName.isEmpty()) return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QMessageBox::warning(this, "Import Failed", file.errorString());
+        return;
+    }
+
+    // Committed as one change; the widgets follow through onExternalChanges
+    QString error;
+    if (!SettingsProfile::importInto(SettingsCache::instance(), &file, SettingsProfile::formatForFileName(fileName), &error)) {
+        QMessageBox::warning(this, "Import Failed", error);
+    }
+}
+
+void SettingsWindow::onExportClicked() {
+    const QString fileName = QFileDialog::getSaveFileName(this, "Export Settings", QString(), ProfileFilter);
+    if (fileName.isEmpty()) return;
+
+    QSaveFile file(fileName);
+    QString error;
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = file.errorString();
+    } else if (SettingsProfile::write(&file, SettingsProfile::formatForFileName(fileName), sessionSnapshot, &error)
+               && !file.commit()) {
+        error = file.errorString();
+    }
+    if (!error.isEmpty()) {
+        QMessageBox::warning(this, "Export Failed", error);
     }
 }
 
 void SettingsWindow::loadSettings() {
-    QSettings s("TestLabs", "TestSettings");
-    for (SettingsItem* item : rootItem->getAllChildren()) {
-        if (!item->isSavingEnabled() || item->isGroup()) continue;
-        QVariant saved = s.value(item->id(), item->defaultValue());
-        if (saved != item->defaultValue()) {
-            applyValueToWidget(item, saved);
+    SettingsCache& cache = SettingsCache::instance();
+    cache.loadFromSettings();
+    migrateLegacySettings();
+
+    // Schema defaults form the lowest scope; controls then show the effective value
+    for (SettingsItem* item : std::as_const(itemsById)) {
+        cache.setValue(item->groupId(), item->id(), item->defaultValue(), SettingsCache::DefaultScope);
+    }
+
+    applyingValues = true;
+    for (SettingsItem* item : std::as_const(itemsById)) {
+        if (!item->isSavingEnabled()) continue;
+        if (cache.sourceScope(item->groupId(), item->id()) != SettingsCache::DefaultScope) {
+            applyValueToWidget(item, cache.getValue(item->groupId(), item->id()));
         }
     }
+    applyingValues = false;
+
+    applyItemStates(dependencies.evaluateAll(currentValue));
+
+    beginSession();
+    cache.setWatchingEnabled(true);
 }
 
-void SettingsWindow::saveSettings() {
-    QSettings s("TestLabs", "TestSettings");
-    for (SettingsItem* item : rootItem->getAllChildren()) {
-        if (!item->isSavingEnabled() || item->isGroup()) continue;
-        s.setValue(item->id(), item->getValue());
+void SettingsWindow::migrateLegacySettings() {
+    QSettings legacy(LegacyOrganization, LegacyApplication);
+    legacy.setFallbacksEnabled(false);
+    const QStringList keys = legacy.childKeys();
+    if (keys.isEmpty()) return;
+
+    // Values already stored under their group win over the legacy copy
+    SettingsCache& cache = SettingsCache::instance();
+    QList<SettingsCache::Change> changes;
+    QStringList migrated;
+    for (const QString& key : keys) {
+        SettingsItem* item = itemsById.value(key);
+        if (!item || !item->isSavingEnabled()) continue;
+        migrated.append(key);
+
+        const QVariant value = legacy.value(key);
+        QString message;
+        if (cache.sourceScope(item->groupId(), item->id()) == SettingsCache::UserScope) continue;
+        if (!cache.validate(item->groupId(), item->id(), value, &message)) {
+            qWarning() << "Dropping legacy setting" << key << "=" << value << ":" << message;
+            continue;
+        }
+        changes.append({item->groupId(), item->id(), value, false});
     }
-    s.sync();
+
+    if (!changes.isEmpty() && !cache.commitChanges(changes)) {
+        qWarning() << "Cannot migrate legacy settings; keeping them for the next start";
+        return;
+    }
+    for (const QString& key : std::as_const(migrated)) {
+        legacy.remove(key);
+    }
+    legacy.sync();
 }
 
 void SettingsWindow::applyValueToWidget(SettingsItem* item, const QVariant& value) {
-    if (auto* cb = item->comboBox()) {
-        int idx = cb->findText(value.toString());
-        if (idx >= 0) cb->setCurrentIndex(idx);
-    } else if (auto* cb = item->checkBox()) {
-        cb->setChecked(value.toBool());
-    } else if (auto* sb = item->spinBox()) {
-        sb->setValue(value.toInt());
-    } else if (auto* le = qobject_cast<QLineEdit*>(item->controlWidget())) {
-        le->setText(value.toString());
-    } else if (auto* wrapper = item->controlWidget()) {
-        if (auto* le = wrapper->findChild<QLineEdit*>()) {
-            le->setText(value.toString());
+    SettingsItemWidget::setValue(item, value);
+    showValidation(item, QString());
+}
+
+void SettingsWindow::connectSignalsForSession() {
+    for (SettingsItem* item : std::as_const(itemsById)) {
+        if (!item->isSavingEnabled()) continue;
+        SettingsItemWidget::connectValueChanged(item, this, [this, item]() { onValueEdited(item); });
+    }
+}
+
+void SettingsWindow::onValueEdited(SettingsItem* item) {
+    if (applyingValues) return;
+
+    QVariant value = SettingsItemWidget::value(item);
+    // Stored values come back as strings; keep the snapshot's copy when the edit
+    // round-trips to it so the group compares equal again
+    const QVariant base = sessionSnapshot.value(item->groupId()).value(item->id());
+    if (base.isValid() && base.toString() == value.toString()) {
+        value = base;
+    }
+
+    // Rejected edits stay in the control, marked, but never reach the cache
+    SettingsCache& cache = SettingsCache::instance();
+    QString message;
+    if (!cache.validate(item->groupId(), item->id(), value, &message)) {
+        showValidation(item, message);
+        return;
+    }
+    showValidation(item, QString());
+
+    cache.setValue(item->groupId(), item->id(), value);
+    updateDependents({item});
+    updateSessionButtons();
+}
+
+void SettingsWindow::showValidation(SettingsItem* item, const QString& message) {
+    QWidget* control = item->controlWidget();
+    if (!control || control->toolTip() == message) return;
+
+    control->setToolTip(message);
+    control->setStyleSheet(message.isEmpty()
+                               ? QString()
+                               : QString("QLineEdit, QAbstractSpinBox, QComboBox { border: 1px solid #d9534f; }"));
+}
+
+void SettingsWindow::updateDependents(const QList<SettingsItem*>& changed) {
+    applyItemStates(dependencies.propagate(changed, currentValue));
+}
+
+void SettingsWindow::applyItemStates(const QList<SettingsItem*>& items) {
+    if (items.isEmpty()) return;
+
+    // One repaint for the whole batch
+    setUpdatesEnabled(false);
+    for (SettingsItem* item : items) {
+        const SettingsDependencyGraph::State state = dependencies.state(item);
+        if (QWidget* control = item->controlWidget()) {
+            control->setEnabled(state.enabled);
+        }
+        if (QHBoxLayout* row = rowsByItem.value(item)) {
+            for (int i = 0; i < row->count(); ++i) {
+                if (QWidget* widget = row->itemAt(i)->widget()) {
+                    widget->setVisible(state.visible);
+                }
+            }
         }
     }
+    setUpdatesEnabled(true);
 }
 
-void SettingsWindow::connectSignalsForAutoSave() {
-    for (SettingsItem* item : rootItem->getAllChildren()) {
-        if (!item->isSavingEnabled() || item->isGroup()) continue;
-
-        if (auto* cb = item->comboBox()) {
-            connect(cb, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingsWindow::saveSettings, Qt::UniqueConnection);
-        } else if (auto* cb = item->checkBox()) {
-            connect(cb, &QCheckBox::toggled, this, &SettingsWindow::saveSettings, Qt::UniqueConnection);
-        } else if (auto* sb = item->spinBox()) {
-            connect(sb, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsWindow::saveSettings, Qt::UniqueConnection);
-        } else if (auto* le = qobject_cast<QLineEdit*>(item->controlWidget())) {
-            connect(le, &QLineEdit::textChanged, this, &SettingsWindow::saveSettings, Qt::UniqueConnection);
-        } else if (auto* wrapper = item->controlWidget()) {
-            if (auto* le = wrapper->findChild<QLineEdit*>()) {
-                connect(le, &QLineEdit::textChanged, this, &SettingsWindow::saveSettings, Qt::UniqueConnection);
+void SettingsWindow::beginSession() {
+    sessionSnapshot = SettingsCache::instance().snapshot();
+    updateSessionButtons();
+}
+
+bool SettingsWindow::applySession() {
+    if (!SettingsCache::instance().saveChanges(sessionSnapshot)) {
+        // Keep the session open so the edits can be applied again
+        QMessageBox::warning(this, "Error", "Cannot write the settings store. The changes were not saved.");
+        return false;
+    }
+    beginSession();
+    return true;
+}
+
+void SettingsWindow::cancelSession() {
+    SettingsCache& cache = SettingsCache::instance();
+    const QList<SettingsCache::Change> changes = SettingsCache::diff(cache.snapshot(), sessionSnapshot);
+    cache.restore(sessionSnapshot);
+
+    // Only controls whose value differs from the snapshot are touched
+    QList<SettingsItem*> changedItems;
+    applyingValues = true;
+    for (const SettingsCache::Change& change : changes) {
+        SettingsItem* item = itemsById.value(change.key);
+        if (!item) continue;
+        applyValueToWidget(item, cache.getValue(change.group, change.key, item->defaultValue()));
+        changedItems.append(item);
+    }
+    applyingValues = false;
+    updateDependents(changedItems);
+
+    updateSessionButtons();
+}
+
+void SettingsWindow::onExternalChanges(const QList<SettingsCache::Change>& changes) {
+    SettingsCache& cache = SettingsCache::instance();
+
+    // The new values become part of the session base, so Cancel keeps them
+    QList<SettingsItem*> changedItems;
+    applyingValues = true;
+    for (const SettingsCache::Change& change : changes) {
+        if (change.removed) {
+            auto groupIt = sessionSnapshot.find(change.group);
+            if (groupIt != sessionSnapshot.end()) {
+                groupIt->remove(change.key);
+                if (groupIt->isEmpty()) sessionSnapshot.erase(groupIt);
             }
+        } else {
+            sessionSnapshot[change.group][change.key] = change.value;
+        }
+
+        if (SettingsItem* item = itemsById.value(change.key)) {
+            applyValueToWidget(item, cache.getValue(change.group, change.key, item->defaultValue()));
+            changedItems.append(item);
         }
     }
+    applyingValues = false;
+    updateDependents(changedItems);
+
+    updateSessionButtons();
+}
+
+bool SettingsWindow::hasPendingChanges() const {
+    return SettingsCache::instance().snapshot() != sessionSnapshot;
+}
+
+void SettingsWindow::updateSessionButtons() {
+    const bool pending = hasPendingChanges();
+    applyButton->setEnabled(pending);
+    cancelButton->setEnabled(pending);
 }
 
 void SettingsWindow::closeEvent(QCloseEvent* event) {
-    saveSettings();
+    if (hasPendingChanges()) {
+        QMessageBox::StandardButton reply = QMessageBox::question(
+            this, "Unsaved Changes", "Apply changes before closing?",
+            QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
+
+        if (reply == QMessageBox::Cancel) {
+            event->ignore();
+            return;
+        }
+        if (reply == QMessageBox::Save) {
+            if (!applySession()) {
+                event->ignore();
+                return;
+            }
+        } else {
+            cancelSession();
+        }
+    }
     event->accept();
-}
\ No newline at end of file
+}
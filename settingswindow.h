@@ -6,8 +6,16 @@
 #include <QStackedWidget>
 #include <QPushButton>
 #include <QMap>
+#include <QHash>
+#include <QHBoxLayout>
+
+#include "settingscache.h"
+#include "settingsdependencygraph.h"
 
 class SettingsItem;
+class QTableWidget;
+class QLabel;
+class QTimer;
 
 class SettingsWindow : public QWidget {
     Q_OBJECT
@@ -23,6 +31,11 @@ private slots:
     void onTreeItemChanged(QTreeWidgetItem* current, QTreeWidgetItem* previous);
     void onResetAllClicked();
     void onResetGroupClicked();
+    void onApplyClicked();
+    void onCancelClicked();
+    void onImportClicked();
+    void onExportClicked();
+    void onExternalChanges(const QList<SettingsCache::Change>& changes);
 
 private:
     void setupUI();
@@ -33,17 +46,53 @@ private:
     void createPageForGroup(SettingsItem* group);
     void setupConnections();
     void loadSettings();
-    void saveSettings();
+    // Moves values saved by older releases (root keys "1".."7") into their groups, once
+    void migrateLegacySettings();
     void applyValueToWidget(SettingsItem* item, const QVariant& value);
-    void connectSignalsForAutoSave();
+    void connectSignalsForSession();
+    void onValueEdited(SettingsItem* item);
+    // Re-evaluates the rules downstream of `changed` and updates the affected rows
+    void updateDependents(const QList<SettingsItem*>& changed);
+    void applyItemStates(const QList<SettingsItem*>& items);
+    // Marks the control of `item` as invalid; an empty message clears the mark
+    void showValidation(SettingsItem* item, const QString& message);
+    // Hidden page listing SettingsMetrics; only added while metrics are enabled
+    void createDiagnosticsPage();
+    void refreshDiagnostics();
+
+    // Editing session: edits go to SettingsCache, Apply persists the diff against
+    // the snapshot taken when the session began, Cancel restores that snapshot.
+    void beginSession();
+    // False if the store could not be written; the session then stays open
+    bool applySession();
+    void cancelSession();
+    bool hasPendingChanges() const;
+    void updateSessionButtons();
 
     QTreeWidget* treeWidget = nullptr;
     QStackedWidget* stackedWidget = nullptr;
     QPushButton* resetAllButton = nullptr;
     QPushButton* resetGroupButton = nullptr;
+    QPushButton* applyButton = nullptr;
+    QPushButton* cancelButton = nullptr;
+    QPushButton* importButton = nullptr;
+    QPushButton* exportButton = nullptr;
     QMap<SettingsItem*, QWidget*> groupPages;
+    QTreeWidgetItem* diagnosticsTreeItem = nullptr;
+    QWidget* diagnosticsPage = nullptr;
+    QTableWidget* diagnosticsTable = nullptr;
+    QTableWidget* lockTable = nullptr;
+    QLabel* filterLabel = nullptr;
+    QLabel* poolLabel = nullptr;
+    QTimer* diagnosticsTimer = nullptr;
 
     SettingsItem* rootItem = nullptr;
+    QHash<QString, SettingsItem*> itemsById;
+    QHash<SettingsItem*, QHBoxLayout*> rowsByItem;
+    SettingsDependencyGraph dependencies;
+
+    SettingsCache::Snapshot sessionSnapshot;
+    bool applyingValues = false;
 };
 
 #endif // SETTINGSWINDOW_H
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "shardedsettingsbackend.h"
+#include "settingsmetrics.h"
+#include "settingsstringpool.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QThreadPool>
+#include <QUrl>
+
+namespace {
+const char* ShardSuffix = ".ini";
+}
+
+ShardedSettingsBackend::ShardedSettingsBackend(const QString& directory)
+    : directory_(directory) {}
+
+QString ShardedSettingsBackend::shardFileName(const QString& group) const {
+    // Group ids may contain characters that are not valid in file names
+    return directory_ + '/' + QString::fromLatin1(QUrl::toPercentEncoding(group)) + ShardSuffix;
+}
+
+SettingsBackend::Group ShardedSettingsBackend::readShard(const QString& fileName) {
+    QSettings shard(fileName, QSettings::IniFormat);
+    Group values;
+    const QStringList keys = shard.childKeys();
+    for (const QString& key : keys) {
+        values.insert(SettingsStringPool::shared(key), shard.value(key));
+    }
+    return values;
+}
+
+SettingsCache::Snapshot ShardedSettingsBackend::load() {
+    const QStringList files = QDir(directory_).entryList({QString("*") + ShardSuffix}, QDir::Files);
+
+    QList<Group> shards(files.size());
+    Group* results = shards.data();
+    QThreadPool pool;
+    for (int i = 0; i < files.size(); ++i) {
+        const QString fileName = directory_ + '/' + files[i];
+        pool.start([results, i, fileName]() {
+            results[i] = readShard(fileName);
+        });
+    }
+    pool.waitForDone();
+
+    SettingsCache::Snapshot values;
+    for (int i = 0; i < files.size(); ++i) {
+        if (shards[i].isEmpty()) continue;
+        const QString encoded = files[i].chopped(int(qstrlen(ShardSuffix)));
+        values.insert(SettingsStringPool::shared(QUrl::fromPercentEncoding(encoded.toLatin1())), shards[i]);
+    }
+    return values;
+}
+
+SettingsBackend::Group ShardedSettingsBackend::loadGroup(const QString& group) {
+    const QString fileName = shardFileName(group);
+    if (!QFile::exists(fileName)) return Group();
+    return readShard(fileName);
+}
+
+bool ShardedSettingsBackend::save(const SettingsCache::Snapshot& values, const QSet<QString>& dirtyGroups) {
+    if (dirtyGroups.isEmpty()) return true;
+    QDir().mkpath(directory_);
+
+    bool ok = true;
+    for (const QString& group : dirtyGroups) {
+        const QString fileName = shardFileName(group);
+        auto groupIt = values.find(group);
+        if (groupIt == values.end() || groupIt->isEmpty()) {
+            if (QFile::exists(fileName) && !QFile::remove(fileName)) ok = false;
+            continue;
+        }
+
+        QSettings shard(fileName, QSettings::IniFormat);
+        shard.clear();
+        for (auto keyIt = groupIt->begin(); keyIt != groupIt->end(); ++keyIt) {
+            shard.setValue(keyIt.key(), keyIt.value());
+        }
+        shard.sync();
+        ok = ok && shard.status() == QSettings::NoError;
+        if (SettingsMetrics::isEnabled()) {
+            SettingsMetrics::add(SettingsMetrics::BytesWritten, quint64(QFileInfo(fileName).size()));
+        }
+    }
+    return ok;
+}
+
+QString ShardedSettingsBackend::journalFileName() const {
+    return directory_ + "/journal";
+}
+
+QStringList ShardedSettingsBackend::watchPaths() const {
+    QStringList paths{journalFileName()};
+    const QStringList files = QDir(directory_).entryList({QString("*") + ShardSuffix}, QDir::Files);
+    for (const QString& file : files) {
+        paths.append(directory_ + '/' + file);
+    }
+    return paths;
+}
@@ -0,0 +1,28 @@
+#ifndef SHARDEDSETTINGSBACKEND_H
+#define SHARDEDSETTINGSBACKEND_H
+
+#include "settingsbackend.h"
+
+// Keeps every top-level group (main_group, template_group, ...) in its own INI
+// file under `directory`, so a save rewrites only the shards that changed.
+// load() reads all shards in parallel; loadGroup() reads a single shard on demand.
+class ShardedSettingsBackend : public SettingsBackend
+{
+public:
+    explicit ShardedSettingsBackend(const QString& directory);
+
+    SettingsCache::Snapshot load() override;
+    Group loadGroup(const QString& group) override;
+    bool save(const SettingsCache::Snapshot& values, const QSet<QString>& dirtyGroups) override;
+    QString journalFileName() const override;
+    QStringList watchPaths() const override;
+
+    QString shardFileName(const QString& group) const;
+
+private:
+    static Group readShard(const QString& fileName);
+
+    QString directory_;
+};
+
+#endif // SHARDEDSETTINGSBACKEND_H
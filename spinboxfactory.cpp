@@ -1,12 +1,9 @@
 #include "spinboxfactory.h"
-#include <QSpinBox>
 #include <algorithm>
 
 SpinBoxFactory::SpinBoxFactory(int min, int max)
-    : min_(min), max_(max) {}
+    : TypedControlFactory(std::min(min, max)), min_(min), max_(max) {}
 
-QWidget* SpinBoxFactory::create() const {
-    QSpinBox* sb = new QSpinBox();
+void SpinBoxFactory::configure(QSpinBox* sb) const {
     sb->setRange(std::min(min_, max_), std::max(min_, max_));
-    return sb;
-}
\ No newline at end of file
+}
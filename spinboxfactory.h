@@ -1,16 +1,25 @@
 #ifndef SPINBOXFACTORY_H
 #define SPINBOXFACTORY_H
 
-#include "settingscontrolfactory.h"
+#include "typedcontrolfactory.h"
+#include <QtWidgets/QSpinBox>
 
-class SpinBoxFactory : public SettingsControlFactory {
+struct SpinBoxTraits {
+    static int value(const QSpinBox* sb) { return sb->value(); }
+    static void setValue(QSpinBox* sb, int value) { sb->setValue(value); }
+    static constexpr auto changedSignal = &QSpinBox::valueChanged;
+};
+
+class SpinBoxFactory : public TypedControlFactory<QSpinBox, int, SpinBoxTraits> {
 public:
     SpinBoxFactory(int min, int max);
-    QWidget* create() const override;
+
+protected:
+    void configure(QSpinBox* sb) const override;
 
 private:
     int min_;
     int max_;
 };
 
-#endif
\ No newline at end of file
+#endif
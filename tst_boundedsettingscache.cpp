@@ -0,0 +1,177 @@
+#include "boundedsettingscache.h"
+#include <QTest>
+
+namespace {
+
+class CountingBackend : public SettingsBackend
+{
+public:
+    SettingsCache::Snapshot load() override { return stored; }
+
+    Group loadGroup(const QString& group) override {
+        ++loads;
+        return stored.value(group);
+    }
+
+    bool save(const SettingsCache::Snapshot& values, const QSet<QString>& dirtyGroups) override {
+        ++saves;
+        if (failSaves) return false;
+        for (const QString& group : dirtyGroups) {
+            if (values.contains(group)) stored.insert(group, values.value(group));
+            else stored.remove(group);
+        }
+        return true;
+    }
+
+    QString journalFileName() const override { return QString(); }
+    QStringList watchPaths() const override { return {}; }
+
+    SettingsCache::Snapshot stored;
+    int loads = 0;
+    int saves = 0;
+    bool failSaves = false;
+};
+
+QString groupName(int i) {
+    return QStringLiteral("entity_%1").arg(i);
+}
+
+}
+
+class TestBoundedSettingsCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void staysWithinBudget();
+    void writesBackEvictedGroups();
+    void revertedGroupIsNotWritten();
+    void filterAnswersMissesOfEvictedGroups();
+    void pinnedGroupsStayResident();
+    void failedWriteBackIsRetriedByFlush();
+};
+
+void TestBoundedSettingsCache::staysWithinBudget() {
+    CountingBackend* backend = new CountingBackend;
+    for (int i = 0; i < 100; ++i) {
+        backend->stored[groupName(i)].insert("name", QStringLiteral("entity %1").arg(i));
+    }
+
+    const qint64 budget = 4096;
+    BoundedSettingsCache cache(backend, budget);
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(cache.value(groupName(i), "name").toString(), QStringLiteral("entity %1").arg(i));
+    }
+
+    const BoundedSettingsCache::Stats stats = cache.stats();
+    QVERIFY(stats.residentBytes <= budget);
+    QVERIFY(stats.evictions > 0);
+    QCOMPARE(stats.writeBacks, quint64(0));
+    QCOMPARE(backend->saves, 0);
+}
+
+void TestBoundedSettingsCache::writesBackEvictedGroups() {
+    CountingBackend* backend = new CountingBackend;
+    {
+        BoundedSettingsCache cache(backend, 2048);
+        for (int i = 0; i < 50; ++i) {
+            cache.setValue(groupName(i), "value", i);
+        }
+        QVERIFY(cache.stats().writeBacks > 0);
+
+        // Evicted and written back, or still queued: either way the value is visible
+        for (int i = 0; i < 50; ++i) {
+            QCOMPARE(cache.value(groupName(i), "value").toInt(), i);
+        }
+        QVERIFY(cache.flush());
+        QCOMPARE(cache.stats().pendingWrites, 0);
+    }
+
+    QCOMPARE(backend->stored.size(), 50);
+    QCOMPARE(backend->stored.value(groupName(7)).value("value").toInt(), 7);
+}
+
+void TestBoundedSettingsCache::revertedGroupIsNotWritten() {
+    CountingBackend* backend = new CountingBackend;
+    backend->stored["g"].insert("a", 1);
+
+    BoundedSettingsCache cache(backend, 1 << 20);
+    cache.setValue("g", "a", 2);
+    cache.setValue("g", "b", 3);
+    cache.setValue("g", "a", 1);
+    cache.remove("g", "b");
+    QVERIFY(cache.flush());
+    QCOMPARE(backend->saves, 0);
+
+    cache.setValue("g", "a", 5);
+    QVERIFY(cache.flush());
+    QCOMPARE(backend->saves, 1);
+    QCOMPARE(backend->stored.value("g").value("a").toInt(), 5);
+}
+
+void TestBoundedSettingsCache::filterAnswersMissesOfEvictedGroups() {
+    CountingBackend* backend = new CountingBackend;
+    for (int i = 0; i < 20; ++i) {
+        backend->stored[groupName(i)].insert("present", i);
+    }
+
+    // Room for a single group, so loading the second evicts the first
+    BoundedSettingsCache cache(backend, 300);
+    QVERIFY(cache.contains(groupName(0), "present"));
+    QVERIFY(cache.contains(groupName(1), "present"));
+    QCOMPARE(cache.stats().residentGroups, 1);
+    QCOMPARE(cache.stats().filters, 1);
+    QVERIFY(cache.stats().filterBytes > 0);
+
+    const int loads = backend->loads;
+    QVERIFY(!cache.contains(groupName(0), "absent"));
+    QCOMPARE(cache.value(groupName(0), "absent", 42).toInt(), 42);
+    QCOMPARE(backend->loads, loads);
+    QCOMPARE(cache.stats().filterRejects, quint64(2));
+
+    // Keys the group has still reload it
+    QCOMPARE(cache.value(groupName(0), "present").toInt(), 0);
+    QCOMPARE(backend->loads, loads + 1);
+    QCOMPARE(cache.stats().filterFalsePositives, quint64(0));
+}
+
+void TestBoundedSettingsCache::pinnedGroupsStayResident() {
+    CountingBackend* backend = new CountingBackend;
+    BoundedSettingsCache cache(backend, 1 << 20);
+    cache.setValue("pinned", "k", 1);
+    cache.pin("pinned");
+    cache.setMemoryBudget(0);
+    QCOMPARE(cache.stats().residentGroups, 1);
+    QCOMPARE(backend->saves, 0);
+
+    cache.unpin("pinned");
+    QCOMPARE(cache.stats().residentGroups, 0);
+    QCOMPARE(backend->stored.value("pinned").value("k").toInt(), 1);
+}
+
+void TestBoundedSettingsCache::failedWriteBackIsRetriedByFlush() {
+    CountingBackend* backend = new CountingBackend;
+    backend->failSaves = true;
+
+    // Room for a single group; touching the second writes the first back
+    BoundedSettingsCache cache(backend, 300);
+    cache.setValue(groupName(0), "a", 1);
+    QCOMPARE(cache.value(groupName(1), "a", 0).toInt(), 0);
+    QCOMPARE(backend->saves, 1);
+
+    // Lookups do not retry the broken store
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(cache.value(groupName(1), "a", 0).toInt(), 0);
+    }
+    QCOMPARE(backend->saves, 1);
+    QCOMPARE(cache.value(groupName(0), "a").toInt(), 1);
+
+    QVERIFY(!cache.flush());
+    QCOMPARE(backend->saves, 2);
+    backend->failSaves = false;
+    QVERIFY(cache.flush());
+    QCOMPARE(backend->stored.value(groupName(0)).value("a").toInt(), 1);
+}
+
+QTEST_GUILESS_MAIN(TestBoundedSettingsCache)
+#include "tst_boundedsettingscache.moc"
@@ -0,0 +1,202 @@
+#include "settingsbackend.h"
+#include "settingscache.h"
+#include "settingsjournal.h"
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+namespace {
+
+// Keeps the store in memory. `failSaves` reports every save as failed after
+// writing it, which looks to the cache like a crash before the journal reset.
+class MemoryBackend : public SettingsBackend
+{
+public:
+    explicit MemoryBackend(const QString& journal) : journal(journal) {}
+
+    SettingsCache::Snapshot load() override { return stored; }
+    Group loadGroup(const QString& group) override { return stored.value(group); }
+
+    bool save(const SettingsCache::Snapshot& values, const QSet<QString>&) override {
+        stored = values;
+        return !failSaves;
+    }
+
+    QString journalFileName() const override { return journal; }
+    QStringList watchPaths() const override { return {}; }
+
+    SettingsCache::Snapshot stored;
+    bool failSaves = false;
+
+private:
+    QString journal;
+};
+
+SettingsCache::Change change(const QString& group, const QString& key, const QVariant& value) {
+    SettingsCache::Change result;
+    result.group = group;
+    result.key = key;
+    result.value = value;
+    return result;
+}
+
+}
+
+class TestSettingsJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void replayAppliesCommitsInOrder();
+    void replayDropsTornTail();
+    void replayDropsTornMultiKeyCommit();
+    void compactionSurvivesCrashBeforeReset();
+    void compactionKeepsOtherProcessCommits();
+    void failedStoreWriteIsReported();
+
+private:
+    QTemporaryDir dir;
+};
+
+void TestSettingsJournal::initTestCase() {
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(dir.isValid());
+}
+
+void TestSettingsJournal::replayAppliesCommitsInOrder() {
+    const QString path = dir.filePath("order.journal");
+    SettingsJournal journal(path);
+    QVERIFY(journal.append({change("g", "a", 1), change("g", "b", 2)}));
+    SettingsCache::Change removal = change("g", "b", QVariant());
+    removal.removed = true;
+    QVERIFY(journal.append({change("g", "a", 3), removal}));
+
+    SettingsCache::Snapshot values;
+    QCOMPARE(SettingsJournal(path).replay(values), 4);
+    QCOMPARE(values.value("g").value("a").toInt(), 3);
+    QVERIFY(!values.value("g").contains("b"));
+
+    QVERIFY(journal.reset());
+    SettingsCache::Snapshot empty;
+    QCOMPARE(SettingsJournal(path).replay(empty), 0);
+}
+
+void TestSettingsJournal::replayDropsTornTail() {
+    const QString path = dir.filePath("torn.journal");
+    {
+        SettingsJournal journal(path);
+        QVERIFY(journal.append({change("g", "a", 1)}));
+        QVERIFY(journal.append({change("g", "b", QString(64, 'x'))}));
+    }
+
+    // Cut the last frame in half, as a crash during the write would
+    QFile file(path);
+    const qint64 size = file.size();
+    QVERIFY(file.resize(size - 20));
+
+    SettingsCache::Snapshot values;
+    QCOMPARE(SettingsJournal(path).replay(values), 1);
+    QCOMPARE(values.value("g").value("a").toInt(), 1);
+    QVERIFY(!values.value("g").contains("b"));
+    QVERIFY(QFile(path).size() < size - 20);
+
+    // Appends after the repair are readable again
+    SettingsJournal journal(path);
+    QVERIFY(journal.append({change("g", "c", 3)}));
+    SettingsCache::Snapshot repaired;
+    QCOMPARE(SettingsJournal(path).replay(repaired), 2);
+    QCOMPARE(repaired.value("g").value("c").toInt(), 3);
+}
+
+void TestSettingsJournal::replayDropsTornMultiKeyCommit() {
+    const QString path = dir.filePath("torncommit.journal");
+    qint64 firstCommit = 0;
+    {
+        SettingsJournal journal(path);
+        QVERIFY(journal.append({change("g", "a", 1)}));
+        firstCommit = journal.size();
+        QVERIFY(journal.append({change("g", "b", 2), change("g", "c", QString(64, 'x')), change("h", "d", 4)}));
+    }
+
+    // Cut after the first key of the second commit
+    QFile file(path);
+    QVERIFY(file.resize(firstCommit + (file.size() - firstCommit) / 3));
+
+    SettingsCache::Snapshot values;
+    QCOMPARE(SettingsJournal(path).replay(values), 1);
+    QCOMPARE(values.value("g").value("a").toInt(), 1);
+    QVERIFY(!values.value("g").contains("b"));
+    QVERIFY(!values.contains("h"));
+    QCOMPARE(QFile(path).size(), firstCommit);
+}
+
+void TestSettingsJournal::compactionSurvivesCrashBeforeReset() {
+    const QString path = dir.filePath("compact.journal");
+    MemoryBackend* backend = new MemoryBackend(path);
+    SettingsCache& cache = SettingsCache::instance();
+    cache.setBackend(backend);
+    cache.loadFromSettings();
+
+    cache.setValue("g", "a", 1);
+    QVERIFY(cache.saveChanges(SettingsCache::Snapshot()));
+
+    // Edited after the last commit, so only the compaction writes it
+    cache.setValue("g", "a", 2);
+    backend->failSaves = true;
+    QVERIFY(!cache.saveToSettings());
+
+    // The journal was not emptied; replaying it over the store must not bring back 1
+    SettingsCache::Snapshot reloaded = backend->stored;
+    SettingsJournal(path).replay(reloaded);
+    QCOMPARE(reloaded.value("g").value("a").toInt(), 2);
+
+    backend->failSaves = false;
+    QVERIFY(cache.saveToSettings());
+    SettingsCache::Snapshot empty;
+    QCOMPARE(SettingsJournal(path).replay(empty), 0);
+    cache.clear();
+}
+
+void TestSettingsJournal::compactionKeepsOtherProcessCommits() {
+    const QString path = dir.filePath("shared.journal");
+    MemoryBackend* backend = new MemoryBackend(path);
+    SettingsCache& cache = SettingsCache::instance();
+    cache.setBackend(backend);
+    cache.loadFromSettings();
+
+    // Another process commits after this one loaded
+    QVERIFY(SettingsJournal(path).append({change("g", "b", 7)}));
+
+    cache.setValue("g", "a", 1);
+    QVERIFY(cache.saveToSettings());
+    QCOMPARE(backend->stored.value("g").value("a").toInt(), 1);
+    QCOMPARE(backend->stored.value("g").value("b").toInt(), 7);
+    SettingsCache::Snapshot empty;
+    QCOMPARE(SettingsJournal(path).replay(empty), 0);
+    cache.clear();
+}
+
+void TestSettingsJournal::failedStoreWriteIsReported() {
+    const QString path = dir.filePath("missing/dir/fail.journal");
+    MemoryBackend* backend = new MemoryBackend(path);
+    SettingsCache& cache = SettingsCache::instance();
+    cache.setBackend(backend);
+    cache.loadFromSettings();
+
+    // Neither the journal (its directory is a file) nor the store can be written
+    QFile blocker(dir.filePath("missing"));
+    QVERIFY(blocker.open(QIODevice::WriteOnly));
+    blocker.close();
+    backend->failSaves = true;
+
+    const SettingsCache::Snapshot base = cache.snapshot();
+    cache.setValue("g", "a", 5);
+    QVERIFY(!cache.saveChanges(base));
+    QVERIFY(!cache.saveToSettings());
+    cache.clear();
+}
+
+QTEST_GUILESS_MAIN(TestSettingsJournal)
+#include "tst_settingsjournal.moc"
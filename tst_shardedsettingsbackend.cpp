@@ -0,0 +1,107 @@
+#include "shardedsettingsbackend.h"
+#include "settingscache.h"
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+class TestShardedSettingsBackend : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void roundTrip();
+    void savesOnlyDirtyGroups();
+    void removesEmptiedGroups();
+    void roundTripThroughCache();
+
+private:
+    QTemporaryDir dir;
+};
+
+void TestShardedSettingsBackend::initTestCase() {
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(dir.isValid());
+}
+
+void TestShardedSettingsBackend::roundTrip() {
+    const QString path = dir.filePath("roundtrip");
+    SettingsCache::Snapshot values;
+    values["main_group"].insert("1", 42);
+    values["main_group"].insert("2", "text");
+    // Not a valid file name as is
+    values["a/b:c"].insert("key", true);
+
+    ShardedSettingsBackend backend(path);
+    QVERIFY(backend.save(values, {"main_group", "a/b:c"}));
+    QVERIFY(QFile::exists(backend.shardFileName("a/b:c")));
+
+    const SettingsCache::Snapshot loaded = ShardedSettingsBackend(path).load();
+    QCOMPARE(loaded.keys(), values.keys());
+    QCOMPARE(loaded.value("main_group").value("1").toInt(), 42);
+    QCOMPARE(loaded.value("main_group").value("2").toString(), QString("text"));
+    QCOMPARE(loaded.value("a/b:c").value("key").toBool(), true);
+
+    const SettingsBackend::Group group = ShardedSettingsBackend(path).loadGroup("main_group");
+    QCOMPARE(group.size(), 2);
+    QVERIFY(ShardedSettingsBackend(path).loadGroup("missing").isEmpty());
+}
+
+void TestShardedSettingsBackend::savesOnlyDirtyGroups() {
+    const QString path = dir.filePath("dirty");
+    SettingsCache::Snapshot values;
+    values["one"].insert("k", 1);
+    values["two"].insert("k", 2);
+
+    ShardedSettingsBackend backend(path);
+    QVERIFY(backend.save(values, {"one", "two"}));
+
+    values["one"].insert("k", 10);
+    values["two"].insert("k", 20);
+    QVERIFY(backend.save(values, {"two"}));
+
+    const SettingsCache::Snapshot loaded = backend.load();
+    QCOMPARE(loaded.value("one").value("k").toInt(), 1);
+    QCOMPARE(loaded.value("two").value("k").toInt(), 20);
+}
+
+void TestShardedSettingsBackend::removesEmptiedGroups() {
+    const QString path = dir.filePath("remove");
+    SettingsCache::Snapshot values;
+    values["one"].insert("k", 1);
+    values["two"].insert("k", 2);
+
+    ShardedSettingsBackend backend(path);
+    QVERIFY(backend.save(values, {"one", "two"}));
+
+    values.remove("one");
+    QVERIFY(backend.save(values, {"one"}));
+    QVERIFY(!QFile::exists(backend.shardFileName("one")));
+    QCOMPARE(backend.load().keys(), QStringList{"two"});
+}
+
+void TestShardedSettingsBackend::roundTripThroughCache() {
+    const QString path = dir.filePath("cache");
+    SettingsCache& cache = SettingsCache::instance();
+    cache.setBackend(new ShardedSettingsBackend(path));
+    cache.loadFromSettings();
+
+    cache.setValue("main_group", "3", 500);
+    cache.setValue("template_group", "5", "name");
+    QVERIFY(cache.saveToSettings());
+
+    const SettingsCache::Snapshot stored = ShardedSettingsBackend(path).load();
+    QCOMPARE(stored.value("main_group").value("3").toInt(), 500);
+    QCOMPARE(stored.value("template_group").value("5").toString(), QString("name"));
+
+    // A fresh load sees the same values
+    cache.clear();
+    cache.setBackend(new ShardedSettingsBackend(path));
+    cache.loadFromSettings();
+    QCOMPARE(cache.getValue("main_group", "3").toInt(), 500);
+    cache.clear();
+}
+
+QTEST_GUILESS_MAIN(TestShardedSettingsBackend)
+#include "tst_shardedsettingsbackend.moc"
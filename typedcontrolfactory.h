@@ -0,0 +1,58 @@
+#ifndef TYPEDCONTROLFACTORY_H
+#define TYPEDCONTROLFACTORY_H
+
+#include "settingscontrolfactory.h"
+
+// Generates creation, typed value access and change notification for a
+// single-widget control. Traits must provide:
+//   static ValueT value(const Widget*);
+//   static void setValue(Widget*, const ValueT&);
+//   static constexpr auto changedSignal = &Widget::someSignal;
+template <typename Widget, typename ValueT, typename Traits>
+class TypedControlFactory : public SettingsControlFactory {
+public:
+    using WidgetType = Widget;
+    using ValueType = ValueT;
+
+    explicit TypedControlFactory(const ValueT& defaultValue = ValueT())
+        : defaultValue_(defaultValue) {}
+
+    QWidget* create() const override {
+        Widget* widget = new Widget();
+        configure(widget);
+        Traits::setValue(widget, defaultValue_);
+        return widget;
+    }
+
+    ValueT typedValue(const QWidget* control) const {
+        return Traits::value(static_cast<const Widget*>(control));
+    }
+
+    void setTypedValue(QWidget* control, const ValueT& value) const {
+        Traits::setValue(static_cast<Widget*>(control), value);
+    }
+
+    QVariant value(const QWidget* control) const override {
+        return QVariant::fromValue(typedValue(control));
+    }
+
+    void setValue(QWidget* control, const QVariant& value) const override {
+        setTypedValue(control, value.value<ValueT>());
+    }
+
+    QMetaObject::Connection connectValueChanged(QWidget* control, QObject* receiver,
+                                                std::function<void()> slot) const override {
+        return QObject::connect(static_cast<Widget*>(control), Traits::changedSignal,
+                                receiver, std::move(slot));
+    }
+
+    const ValueT& defaultValue() const { return defaultValue_; }
+
+protected:
+    virtual void configure(Widget* widget) const { Q_UNUSED(widget); }
+
+private:
+    ValueT defaultValue_;
+};
+
+#endif // TYPEDCONTROLFACTORY_H